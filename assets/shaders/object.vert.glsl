@@ -1,7 +1,7 @@
 #version 430 core
 
 layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aTangent;
+layout(location = 1) in vec3 aTangent; // xy only, octahedral, when uOctFlow
 
 out vec3 vPosWorld;
 out vec3 vDirWorld;
@@ -9,9 +9,26 @@ out vec3 vDirWorld;
 uniform mat4 uModel;
 uniform mat4 uViewproj;
 
+// Compact vertices store positions normalized to the bounding box, see flowfield_quantize.hpp
+uniform vec3 uPosScale;
+uniform vec3 uPosOffset;
+uniform bool uOctFlow;
+
+vec3 octDecode(vec2 e) {
+  vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (v.z < 0.0) {
+    vec2 signNotZero = vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    v.xy = (1.0 - abs(e.yx)) * signNotZero;
+  }
+  return v;
+}
+
 void main() {
-  vPosWorld = (uModel * vec4(aPos, 1)).xyz;
-  vDirWorld = normalize(mat3(uModel) * aTangent);
+  vec3 pos = aPos * uPosScale + uPosOffset;
+  vec3 dir = uOctFlow ? octDecode(aTangent.xy) : aTangent;
+
+  vPosWorld = (uModel * vec4(pos, 1)).xyz;
+  vDirWorld = normalize(mat3(uModel) * dir);
 
   gl_Position = uViewproj * vec4(vPosWorld, 1);
 }
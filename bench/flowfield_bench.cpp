@@ -0,0 +1,1270 @@
+#include "flowfield/flowfield.hpp"
+#include "flowfield/flowfield_detail.hpp"
+#include "flowfield/flowfield_lod.hpp"
+#include "flowfield/flowfield_optimize.hpp"
+#include "flowfield/flowfield_quantize.hpp"
+#include "flowfield/flowfield_stream.hpp"
+#include "flowfield/parallel.hpp"
+#include "flowfield/synthetic_mesh.hpp"
+#include "flowfield/tri_geometry.hpp"
+
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace flowfield::detail;
+
+struct Timing {
+  double minMs = 0.0;
+  double medianMs = 0.0;
+  double p95Ms = 0.0;
+};
+
+// Untimed runs before the timed ones of every measurement, set with --warmup
+static int warmupRuns = 1;
+
+static Timing measure(int reps, const std::function<void()>& fn) {
+  for (int w = 0; w < warmupRuns; ++w) fn();
+
+  std::vector<double> ms;
+  for (int r = 0; r < reps; ++r) {
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    auto t1 = std::chrono::steady_clock::now();
+    ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  std::sort(ms.begin(), ms.end());
+  const size_t p95 = (size_t)std::ceil(0.95 * (double)ms.size()) - 1;
+  return Timing{ms.front(), ms[ms.size() / 2], ms[p95]};
+}
+
+// The tinyobj based loader that loadObjAsPolys used before the dedicated parser, kept as reference
+static bool loadObjTinyobj(const std::string& path, ObjPolys& out) {
+  tinyobj::ObjReaderConfig cfg;
+  cfg.triangulate = false;
+
+  tinyobj::ObjReader reader;
+  if (!reader.ParseFromFile(path, cfg)) return false;
+
+  out.attrib = reader.GetAttrib();
+  out.nV_in = (int)(out.attrib.vertices.size() / 3);
+  out.nVT_in = (int)(out.attrib.texcoords.size() / 2);
+
+  out.polys = Csr<tinyobj::index_t>();
+  for (const auto& sh : reader.GetShapes()) {
+    size_t index_offset = 0;
+    for (size_t f = 0; f < sh.mesh.num_face_vertices.size(); f++) {
+      int fv = sh.mesh.num_face_vertices[f];
+      if (fv >= 3) {
+        const auto first = sh.mesh.indices.begin() + (ptrdiff_t)index_offset;
+        out.polys.items.insert(out.polys.items.end(), first, first + fv);
+        out.polys.offset.push_back((int)out.polys.items.size());
+      }
+      index_offset += (size_t)fv;
+    }
+  }
+  return true;
+}
+
+static std::vector<std::string> findModels(const std::string& dir) {
+  std::vector<std::string> models;
+  std::error_code ec;
+  for (const auto& e : std::filesystem::directory_iterator(dir, ec)) {
+    if (e.path().extension() == ".obj") models.push_back(e.path().string());
+  }
+  std::sort(models.begin(), models.end());
+  return models;
+}
+
+// Faces without texcoords or with normals only must come back with -1 for the missing indices, as tinyobj does
+static bool checkUntexturedCorners() {
+  const std::string path = (std::filesystem::temp_directory_path() / "flowfield_bench_untextured.obj").string();
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) return false;
+  std::fputs("v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvt 0 0\nvn 0 0 1\n", f);
+  std::fputs("f 1/1/1 2/1/1 3/1/1\nf 2//1 4//1 3//1\nf 1 2 4\nf -4/-1 -3 -1//-1\n", f);
+  std::fclose(f);
+
+  static const int expectedTexcoord[] = {0, 0, 0, -1, -1, -1, -1, -1, -1, 0, -1, -1};
+  ObjPolys m;
+  bool ok = loadObjAsPolys(path, m, 1) && m.polys.items.size() == std::size(expectedTexcoord);
+  for (size_t c = 0; ok && c < m.polys.items.size(); ++c) {
+    ok = m.polys.items[c].texcoord_index == expectedTexcoord[c] && m.polys.items[c].normal_index == -1;
+  }
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+  return ok;
+}
+
+// Returns false when the parser and tinyobj disagree on a model or untextured corners are not left at -1
+static bool benchLoader(const std::vector<std::string>& models, int reps, int threads) {
+  const bool untexturedOk = checkUntexturedCorners();
+  std::printf("untextured corners: %s\n\n", untexturedOk ? "ok" : "WRONG");
+
+  bool allSame = untexturedOk;
+  std::printf("%-32s %8s %12s %12s %12s %8s\n", "model", "MB", "tinyobj ms", "parser 1T", "parser NT", "speedup");
+
+  for (const auto& path : models) {
+    ObjPolys ref, m1, mN;
+    if (!loadObjTinyobj(path, ref) || !loadObjAsPolys(path, m1, 1) || !loadObjAsPolys(path, mN, threads)) {
+      std::printf("%-32s failed to load\n", path.c_str());
+      continue;
+    }
+
+    bool same = ref.polys.offset == mN.polys.offset && ref.attrib.vertices == mN.attrib.vertices;
+    for (size_t c = 0; same && c < ref.polys.items.size(); ++c) {
+      same = ref.polys.items[c].vertex_index == mN.polys.items[c].vertex_index
+          && ref.polys.items[c].texcoord_index == mN.polys.items[c].texcoord_index;
+    }
+
+    const double mb = (double)std::filesystem::file_size(path) / (1024.0 * 1024.0);
+    Timing tRef = measure(reps, [&] { loadObjTinyobj(path, ref); });
+    Timing t1 = measure(reps, [&] { loadObjAsPolys(path, m1, 1); });
+    Timing tN = measure(reps, [&] { loadObjAsPolys(path, mN, threads); });
+
+    std::printf(
+        "%-32s %8.2f %12.2f %12.2f %12.2f %7.1fx%s\n",
+        std::filesystem::path(path).filename().string().c_str(),
+        mb,
+        tRef.medianMs,
+        t1.medianMs,
+        tN.medianMs,
+        tRef.medianMs / std::max(tN.medianMs, 1e-6),
+        same ? "" : "  (MISMATCH)"
+    );
+    allSame = allSame && same;
+  }
+  return allSame;
+}
+
+static void printHashRow(const std::string& model, const char* workload, const Timing& tStd, const Timing& tFlat) {
+  std::printf(
+      "%-20s %-14s %12.3f %12.3f %7.1fx\n",
+      model.c_str(),
+      workload,
+      tStd.medianMs,
+      tFlat.medianMs,
+      tStd.medianMs / std::max(tFlat.medianMs, 1e-6)
+  );
+}
+
+// (v, vt, smoothing group) corner key of the hash map based vertex split that buildSplitMesh used to do
+struct SplitKey {
+  int v, vt, sg;
+  bool operator==(const SplitKey& o) const noexcept { return v == o.v && vt == o.vt && sg == o.sg; }
+};
+
+struct SplitKeyHash {
+  std::size_t operator()(const SplitKey& k) const noexcept {
+    uint64_t a = (uint32_t)k.v;
+    uint64_t b = (uint32_t)(k.vt + 1);
+    uint64_t c = (uint32_t)k.sg;
+    uint64_t x = (a * 1315423911ULL) ^ (b * 2654435761ULL) ^ (c * 97531ULL);
+    x ^= (x >> 33);
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= (x >> 33);
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= (x >> 33);
+    return (size_t)x;
+  }
+};
+
+// Hash workloads of the pipeline stages, std::unordered_map/set vs. FlatHashMap/Set on the same keys
+static void benchHash(const std::vector<std::string>& models, int reps, int threads) {
+  std::printf("%-20s %-14s %12s %12s %8s\n", "model", "workload", "std ms", "flat ms", "speedup");
+
+  for (const auto& path : models) {
+    ObjPolys m;
+    if (!loadObjAsPolys(path, m, threads)) continue;
+    const std::string name = std::filesystem::path(path).filename().string();
+
+    const auto tris = triangulate(m);
+    TriGeometry geom;
+    computeTriGeometry(m, tris, geom, threads);
+
+    std::vector<EdgeKey> polyEdges, triEdges;
+    for (int p = 0; p < m.polys.rows(); ++p) {
+      const auto poly = m.polys.row(p);
+      for (int i = 0; i < poly.size(); ++i) {
+        const int a = poly[i].vertex_index, b = poly[(i + 1) % poly.size()].vertex_index;
+        polyEdges.push_back(EdgeKey{std::min(a, b), std::max(a, b)});
+      }
+    }
+    for (const Tri& t : tris) {
+      const int v[3] = {t.v0(), t.v1(), t.v2()};
+      for (int i = 0; i < 3; ++i) {
+        const int a = v[i], b = v[(i + 1) % 3];
+        triEdges.push_back(EdgeKey{std::min(a, b), std::max(a, b)});
+      }
+    }
+
+    // buildUvNeighbors: first face per polygon edge
+    {
+      Timing tStd = measure(reps, [&] {
+        std::unordered_map<EdgeKey, int, EdgeKeyHash> map;
+        map.reserve(polyEdges.size());
+        for (size_t i = 0; i < polyEdges.size(); ++i) map.emplace(polyEdges[i], (int)i);
+      });
+      Timing tFlat = measure(reps, [&] {
+        FlatHashMap<EdgeKey, int, EdgeKeyHash> map(emptyEdgeKey, polyEdges.size());
+        for (size_t i = 0; i < polyEdges.size(); ++i) map.tryEmplace(polyEdges[i], (int)i);
+      });
+      printHashRow(name, "uvNeighbors", tStd, tFlat);
+    }
+
+    // buildEdgeToTris: first two triangles per edge
+    {
+      Timing tStd = measure(reps, [&] {
+        std::unordered_map<EdgeKey, std::pair<int, int>, EdgeKeyHash> map;
+        map.reserve(tris.size() * 2);
+        for (size_t i = 0; i < triEdges.size(); ++i) {
+          auto it = map.find(triEdges[i]);
+          if (it == map.end()) map.emplace(triEdges[i], std::make_pair((int)i / 3, -1));
+          else if (it->second.second == -1) it->second.second = (int)i / 3;
+        }
+      });
+      Timing tFlat = measure(reps, [&] {
+        FlatHashMap<EdgeKey, std::pair<int, int>, EdgeKeyHash> map(emptyEdgeKey, tris.size() * 3 / 2);
+        for (size_t i = 0; i < triEdges.size(); ++i) {
+          auto [tt, inserted] = map.tryEmplace(triEdges[i], std::make_pair((int)i / 3, -1));
+          if (!inserted && tt->second == -1) tt->second = (int)i / 3;
+        }
+      });
+      printHashRow(name, "edgeToTris", tStd, tFlat);
+    }
+
+    // Crease set lookups for every triangle edge (30 deg creases)
+    {
+      const auto topo = buildTopology(m, tris);
+      const auto creaseEdge = computeCreaseEdges(topo, geom, 30.0, threads);
+      std::unordered_set<EdgeKey, EdgeKeyHash> stdSet;
+      FlatHashSet<EdgeKey, EdgeKeyHash> creases(emptyEdgeKey);
+      for (int e = 0; e < topo.edges(); ++e) {
+        if (!creaseEdge[(size_t)e]) continue;
+        stdSet.insert(triEdges[(size_t)topo.edgeHalf[(size_t)e]]);
+        creases.insert(triEdges[(size_t)topo.edgeHalf[(size_t)e]]);
+      }
+
+      size_t hits = 0;
+      Timing tStd = measure(reps, [&] {
+        for (const EdgeKey& e : triEdges) hits += stdSet.count(e);
+      });
+      Timing tFlat = measure(reps, [&] {
+        for (const EdgeKey& e : triEdges) hits += creases.contains(e) ? 1 : 0;
+      });
+      printHashRow(name, "creaseLookup", tStd, tFlat);
+    }
+
+    // buildSplitMesh: output vertex per (v, vt, sg) corner key
+    {
+      Timing tStd = measure(reps, [&] {
+        std::unordered_map<SplitKey, int, SplitKeyHash> map;
+        map.reserve(m.polys.items.size());
+        for (const auto& idx : m.polys.items) {
+          SplitKey key{idx.vertex_index, idx.texcoord_index, 0};
+          if (map.find(key) == map.end()) map.emplace(key, (int)map.size());
+        }
+      });
+      Timing tFlat = measure(reps, [&] {
+        FlatHashMap<SplitKey, int, SplitKeyHash> map(SplitKey{-1, -1, -1}, m.polys.items.size());
+        for (const auto& idx : m.polys.items) {
+          map.tryEmplace(SplitKey{idx.vertex_index, idx.texcoord_index, 0}, (int)map.size());
+        }
+      });
+      printHashRow(name, "splitMap", tStd, tFlat);
+    }
+  }
+}
+
+// Synthetic accumulator input for buildFlowFromAccum: compCount rings of compSize vertices in a plane.
+// Tangents alternate in sign to exercise the orientation pass and every fifth vertex has none.
+struct SyntheticAccum {
+  std::vector<Eigen::Vector3d> vNormal, vTangent;
+  std::vector<double> vWeight;
+  Csr<int> adj;
+};
+
+static SyntheticAccum makeRingComponents(int compCount, int compSize) {
+  SyntheticAccum s;
+  const int n = compCount * compSize;
+  s.vNormal.assign((size_t)n, Eigen::Vector3d(0, 0, 1));
+  s.vTangent.resize((size_t)n);
+  s.vWeight.resize((size_t)n);
+
+  s.adj.offset.resize((size_t)n + 1);
+  s.adj.items.reserve((size_t)n * 2);
+
+  for (int c = 0; c < compCount; ++c) {
+    const int base = c * compSize;
+    for (int i = 0; i < compSize; ++i) {
+      const int v = base + i;
+      const double a = 0.3 * (double)(v % 7);
+      const double dir = (v % 2) ? -1.0 : 1.0;
+      s.vWeight[(size_t)v] = (v % 5 == 4) ? 0.0 : 1.0;
+      s.vTangent[(size_t)v] = s.vWeight[(size_t)v] * dir * Eigen::Vector3d(std::cos(a), std::sin(a), 0);
+
+      if (compSize > 1) {
+        s.adj.items.push_back(base + (i + compSize - 1) % compSize);
+        s.adj.items.push_back(base + (i + 1) % compSize);
+      }
+      s.adj.offset[(size_t)v + 1] = (int)s.adj.items.size();
+    }
+  }
+  return s;
+}
+
+// buildFlowFromAccum on a fixed vertex budget split into more and more components. The time per vertex
+// should stay flat, whatever the component count.
+static void benchComponents(int reps, int threads) {
+  std::printf("%10s %10s %10s %12s %12s\n", "comps", "comp size", "vertices", "median ms", "ns/vertex");
+
+  constexpr int totalVerts = 1 << 20;
+  for (int compSize = totalVerts; compSize >= 4; compSize /= 8) {
+    const int compCount = totalVerts / compSize;
+    const SyntheticAccum s = makeRingComponents(compCount, compSize);
+
+    Timing t = measure(reps, [&] { buildFlowFromAccum(s.vNormal, s.vTangent, s.vWeight, s.adj, threads); });
+
+    std::printf(
+        "%10d %10d %10d %12.3f %12.1f\n",
+        compCount,
+        compSize,
+        totalVerts,
+        t.medianMs,
+        t.medianMs * 1e6 / totalVerts
+    );
+  }
+}
+
+// Angle between two directions, accurate for small angles. Zero if either is zero.
+static double angleBetween(const Eigen::Vector3d& a, const Eigen::Vector3d& b) {
+  if (a.squaredNorm() == 0.0 || b.squaredNorm() == 0.0) return 0.0;
+  return std::atan2(a.cross(b).norm(), a.dot(b));
+}
+
+// Every computeTriGeometry kernel the CPU supports, timed and checked against the double reference on
+// triangles that are not slivers in either position or UV space
+// Whether every stream of a and b holds the same bits
+static bool sameBits(const TriGeometry& a, const TriGeometry& b) {
+  const std::vector<float> TriGeometry::*streams[] = {
+      &TriGeometry::nx, &TriGeometry::ny, &TriGeometry::nz, &TriGeometry::area, &TriGeometry::ux,
+      &TriGeometry::uy, &TriGeometry::uz, &TriGeometry::vx, &TriGeometry::vy, &TriGeometry::vz,
+  };
+  for (auto stream : streams) {
+    const std::vector<float>& x = a.*stream;
+    const std::vector<float>& y = b.*stream;
+    if (x.size() != y.size() || std::memcmp(x.data(), y.data(), x.size() * sizeof(float)) != 0) return false;
+  }
+  return true;
+}
+
+// Times every kernel and checks the float ones against Reference within the validated tolerance and against
+// each other bit for bit. Returns false if any check fails.
+static bool benchGeometry(const std::vector<std::string>& models, int reps, int threads) {
+  std::printf(
+      "%-20s %-10s %10s %10s %12s %12s %12s %8s %6s %s\n",
+      "model",
+      "kernel",
+      "median ms",
+      "speedup",
+      "max n rad",
+      "max t rad",
+      "max area rel",
+      "flips",
+      "bits",
+      "check"
+  );
+
+  bool allOk = true;
+  const GeometryKernel kernels[] = {
+      GeometryKernel::Reference, GeometryKernel::Scalar, GeometryKernel::Sse, GeometryKernel::Avx2
+  };
+
+  for (const auto& path : models) {
+    ObjPolys m;
+    if (!loadObjAsPolys(path, m, threads)) continue;
+    const std::string name = std::filesystem::path(path).filename().string();
+    const auto tris = triangulate(m);
+
+    // Shape measure 2 * area / longest edge^2, about 0.87 for equilateral triangles and 0 for slivers
+    auto shape = [](const Eigen::Vector3d& a, const Eigen::Vector3d& b, const Eigen::Vector3d& c) {
+      const double longest = std::max({(b - a).squaredNorm(), (c - b).squaredNorm(), (a - c).squaredNorm()});
+      return longest > 0.0 ? (b - a).cross(c - a).norm() / longest : 0.0;
+    };
+
+    std::vector<uint8_t> wellShaped(tris.size());
+    for (size_t ti = 0; ti < tris.size(); ++ti) {
+      Eigen::Vector3d p[3], w[3] = {Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero()};
+      bool uvOk = true;
+      for (int k = 0; k < 3; ++k) {
+        const tinyobj::index_t& idx = tris[ti].corner(k).idx;
+        p[k] = toV3(m.attrib.vertices, idx.vertex_index);
+        uvOk &= idx.texcoord_index >= 0;
+        if (uvOk) w[k] << toV2(m.attrib.texcoords, idx.texcoord_index), 0.0;
+      }
+      wellShaped[ti] = shape(p[0], p[1], p[2]) >= geometryShapeThreshold
+                    && (!uvOk || shape(w[0], w[1], w[2]) >= geometryShapeThreshold);
+    }
+
+    TriGeometry ref, scalar;
+    computeTriGeometry(m, tris, ref, threads, GeometryKernel::Reference);
+    computeTriGeometry(m, tris, scalar, threads, GeometryKernel::Scalar);
+    double refMs = 0.0;
+
+    for (GeometryKernel kernel : kernels) {
+      if (!geometryKernelSupported(kernel)) continue;
+
+      TriGeometry g;
+      Timing t = measure(reps, [&] { computeTriGeometry(m, tris, g, threads, kernel); });
+      if (kernel == GeometryKernel::Reference) refMs = t.medianMs;
+
+      // flips: triangles where one side has a normal or tangent and the other has none
+      double maxN = 0.0, maxT = 0.0, maxArea = 0.0;
+      size_t flips = 0;
+      for (size_t ti = 0; ti < tris.size(); ++ti) {
+        const bool hasRef[3] = {ref.area[ti] > 0, ref.dPdu(ti).squaredNorm() > 0, ref.dPdv(ti).squaredNorm() > 0};
+        const bool hasOut[3] = {g.area[ti] > 0, g.dPdu(ti).squaredNorm() > 0, g.dPdv(ti).squaredNorm() > 0};
+        if (!wellShaped[ti]) continue;
+        for (int k = 0; k < 3; ++k) flips += hasRef[k] != hasOut[k];
+
+        maxN = std::max(maxN, angleBetween(ref.normal(ti), g.normal(ti)));
+        maxT = std::max({maxT, angleBetween(ref.dPdu(ti), g.dPdu(ti)), angleBetween(ref.dPdv(ti), g.dPdv(ti))});
+        if (ref.area[ti] > 0) maxArea = std::max(maxArea, std::abs((double)g.area[ti] / ref.area[ti] - 1.0));
+      }
+
+      // The float kernels must agree bit for bit, Reference is only held to the tolerance
+      const bool isFloat = kernel != GeometryKernel::Reference;
+      const bool same = !isFloat || sameBits(g, scalar);
+      const bool ok = maxN <= geometryAngleTolerance && maxT <= geometryAngleTolerance
+                   && maxArea <= geometryAreaTolerance && flips == 0 && same;
+      allOk = allOk && ok;
+      std::printf(
+          "%-20s %-10s %10.3f %9.1fx %12.2e %12.2e %12.2e %8zu %6s %s\n",
+          name.c_str(),
+          geometryKernelName(kernel),
+          t.medianMs,
+          refMs / std::max(t.medianMs, 1e-6),
+          maxN,
+          maxT,
+          maxArea,
+          flips,
+          !isFloat ? "-" : same ? "same" : "DIFF",
+          ok ? "ok" : "FAIL"
+      );
+    }
+  }
+  return allOk;
+}
+
+// accumulateNormalsAndTangents per axis mode with double and float sums, and how far the flow of the float
+// sums strays from the double one
+static void benchAccumulate(const std::vector<std::string>& models, int reps, int threads) {
+  std::printf(
+      "%-20s %5s %12s %12s %8s %12s %8s\n",
+      "model",
+      "axis",
+      "double ms",
+      "float ms",
+      "speedup",
+      "max line rad",
+      "flips"
+  );
+
+  for (const auto& path : models) {
+    ObjPolys m;
+    if (!loadObjAsPolys(path, m, threads)) continue;
+    const std::string name = std::filesystem::path(path).filename().string();
+    const auto tris = triangulate(m);
+    const auto topo = buildTopology(m, tris);
+    TriGeometry geom;
+    computeTriGeometry(m, tris, geom, threads);
+    const auto polyIsland = computeFaceIslands(m, tris, topo, threads);
+    const auto islands = scoreIslandsAxis(m, geom, polyIsland, threads);
+    const auto split = buildSplitMesh(m, tris, topo, computeCreaseEdges(topo, geom, 30.0, threads), 30.0, threads);
+    const auto adj = buildAdjacencyVec(tris, topo, split.cornerOut, (int)split.outPos.size());
+    const int nV = (int)split.outPos.size();
+
+    for (char axis : {'U', 'V', 'A'}) {
+      std::vector<Eigen::Vector3d> flow[2];
+      Timing t[2];
+      for (int single = 0; single < 2; ++single) {
+        std::vector<Eigen::Vector3d> vNormal, vTangent;
+        std::vector<double> vWeight;
+        auto run = [&] {
+          accumulateNormalsAndTangents(
+              tris, polyIsland, islands, axis, geom, split.cornerOut, nV, vNormal, vTangent, vWeight, threads, single
+          );
+        };
+        t[single] = measure(reps, run);
+        flow[single] = buildFlowFromAccum(vNormal, vTangent, vWeight, adj, threads);
+      }
+
+      // Where the tangent contributions nearly cancel, the rounding can pick the other sign
+      double maxFlow = 0.0;
+      size_t flips = 0;
+      for (int v = 0; v < nV; ++v) {
+        const double angle = angleBetween(flow[0][(size_t)v], flow[1][(size_t)v]);
+        if (angle > M_PI / 2) flips++;
+        maxFlow = std::max(maxFlow, std::min(angle, M_PI - angle));
+      }
+
+      std::printf(
+          "%-20s %5c %12.3f %12.3f %7.2fx %12.2e %8zu\n",
+          name.c_str(),
+          axis,
+          t[0].medianMs,
+          t[1].medianMs,
+          t[0].medianMs / std::max(t[1].medianMs, 1e-6),
+          maxFlow,
+          flips
+      );
+    }
+  }
+}
+
+// Per-stage memory report of a full bake with levels of detail and draw order optimization
+static void benchMemory(const std::vector<std::string>& models, int threads) {
+  std::printf("%-20s %-12s %12s %12s %12s\n", "model", "stage", "scratch KB", "kept KB", "peak KB");
+
+  for (const auto& path : models) {
+    const std::string name = std::filesystem::path(path).filename().string();
+    FlowfieldSettings settings{'A', 30.0f, threads};
+    settings.lodLevels = 3;
+    settings.optimizeDrawOrder = true;
+
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+    std::vector<FlowfieldLod> lods;
+    FlowfieldMemoryReport report;
+    if (!ComputeUvFlowfieldFromOBJ(path, verts, indices, settings, &lods, &report)) continue;
+
+    for (const FlowfieldStageMemory& m : report.stages) {
+      std::printf(
+          "%-20s %-12s %12.1f %12.1f %12.1f\n",
+          name.c_str(),
+          m.stage,
+          m.scratchBytes / 1024.0,
+          m.keptBytes / 1024.0,
+          m.peakBytes / 1024.0
+      );
+    }
+    std::printf(
+        "%-20s %-12s %12.1f %12s %12.1f\n",
+        name.c_str(),
+        "bake",
+        report.arenaReservedBytes / 1024.0,
+        "",
+        report.peakBytes / 1024.0
+    );
+  }
+}
+
+// FlowfieldBaker: a full bake against rebakes after an axis or crease angle change. Each timed rebake
+// toggles the setting so it always invalidates the stages.
+static void benchRebuild(const std::vector<std::string>& models, int reps, int threads) {
+  std::printf("%-20s %12s %12s %12s\n", "model", "full ms", "axis ms", "crease ms");
+
+  for (const auto& path : models) {
+    const std::string name = std::filesystem::path(path).filename().string();
+    FlowfieldSettings settings{'A', 30.0f, threads};
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+
+    Timing full = measure(reps, [&] {
+      FlowfieldBaker baker;
+      baker.Bake(path, verts, indices, settings);
+    });
+
+    FlowfieldBaker baker;
+    if (!baker.Bake(path, verts, indices, settings)) continue;
+
+    Timing axis = measure(reps, [&] {
+      settings.axis = (settings.axis == 'A') ? 'U' : 'A';
+      baker.Bake(path, verts, indices, settings);
+    });
+    Timing crease = measure(reps, [&] {
+      settings.creaseThresholdAngle = (settings.creaseThresholdAngle == 30.0f) ? 45.0f : 30.0f;
+      baker.Bake(path, verts, indices, settings);
+    });
+
+    std::printf("%-20s %12.3f %12.3f %12.3f\n", name.c_str(), full.medianMs, axis.medianMs, crease.medianMs);
+  }
+}
+
+// BakeFlowfieldStreaming at shrinking memory limits against the in-memory bake. The streaming bakes write
+// to a scratch cache directory, so timings include storing the entry.
+static void benchStream(const std::vector<std::string>& models, int reps, int threads) {
+  const size_t limitsMb[] = {1024, 4, 1};
+  const std::string cacheDir = (std::filesystem::temp_directory_path() / "flowfield_bench_cache").string();
+
+  std::printf("%-20s %10s %12s %8s %12s %12s\n", "model", "limit MB", "ms", "chunks", "halo faces", "border verts");
+
+  for (const auto& path : models) {
+    const std::string name = std::filesystem::path(path).filename().string();
+    FlowfieldSettings settings{'A', 30.0f, threads};
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+
+    const uint64_t objHash = HashFileContents(path);
+    Timing inMemory = measure(reps, [&] { ComputeUvFlowfieldFromOBJ(path, verts, indices, settings); });
+    std::printf("%-20s %10s %12.3f\n", name.c_str(), "in-memory", inMemory.medianMs);
+
+    for (size_t mb : limitsMb) {
+      StreamingBakeOptions options;
+      options.memoryLimit = mb << 20;
+      StreamingBakeStats stats;
+      bool ok = true;
+
+      Timing t = measure(reps, [&] { ok &= BakeFlowfieldStreaming(path, objHash, settings, options, &stats, cacheDir); });
+      if (!ok) {
+        std::printf("%-20s %10zu %12s\n", name.c_str(), mb, "FAIL");
+        continue;
+      }
+      std::printf(
+          "%-20s %10zu %12.3f %8d %12zu %12zu\n",
+          name.c_str(),
+          mb,
+          t.medianMs,
+          stats.chunks,
+          stats.haloFaces,
+          stats.borderVertices
+      );
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::remove_all(cacheDir, ec);
+}
+
+// BuildFlowfieldLods on the baked meshes: build time and the triangle count and error of every level. The
+// error is also given relative to the bounding box diagonal.
+static void benchLod(const std::vector<std::string>& models, int reps, int threads) {
+  std::printf("%-20s %12s %6s %10s %12s %12s\n", "model", "build ms", "level", "triangles", "error", "rel error");
+
+  for (const auto& path : models) {
+    const std::string name = std::filesystem::path(path).filename().string();
+    FlowfieldSettings settings{'A', 30.0f, threads};
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+    if (!ComputeUvFlowfieldFromOBJ(path, verts, indices, settings)) continue;
+
+    std::vector<unsigned int> lodIndices;
+    std::vector<FlowfieldLod> lods;
+    Timing t = measure(reps, [&] {
+      lodIndices = indices;
+      lods = BuildFlowfieldLods(verts, lodIndices);
+    });
+
+    Eigen::Vector3f lo = Eigen::Vector3f::Constant(INFINITY), hi = -lo;
+    for (size_t i = 0; i < verts.size(); i += 6) {
+      lo = lo.cwiseMin(Eigen::Vector3f(verts[i], verts[i + 1], verts[i + 2]));
+      hi = hi.cwiseMax(Eigen::Vector3f(verts[i], verts[i + 1], verts[i + 2]));
+    }
+    const float diagonal = (hi - lo).norm();
+
+    std::printf("%-20s %12.3f\n", name.c_str(), t.medianMs);
+    for (size_t l = 0; l < lods.size(); ++l) {
+      const float rel = diagonal > 0.0f ? lods[l].error / diagonal : 0.0f;
+      std::printf("%-20s %12s %6zu %10u %12.5f %12.5f\n", "", "", l, lods[l].indexCount / 3, lods[l].error, rel);
+    }
+  }
+}
+
+// Triangles as position triples, each rotated to start at its smallest corner so winding is kept, sorted
+static std::vector<std::array<float, 9>> canonicalTriangles(
+    const std::vector<float>& verts,
+    const std::vector<unsigned int>& indices
+) {
+  std::vector<std::array<float, 9>> out(indices.size() / 3);
+  for (size_t t = 0; t < out.size(); ++t) {
+    const float* c[3];
+    for (int k = 0; k < 3; ++k) c[k] = verts.data() + (size_t)indices[t * 3 + k] * 6;
+    int first = 0;
+    for (int k = 1; k < 3; ++k) {
+      if (std::lexicographical_compare(c[k], c[k] + 3, c[first], c[first] + 3)) first = k;
+    }
+    for (int k = 0; k < 3; ++k) std::copy_n(c[(first + k) % 3], 3, out[t].data() + k * 3);
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+static void benchDrawOrder(const std::vector<std::string>& models, int reps, int threads) {
+  std::printf(
+      "%-20s %10s %8s %8s %8s %8s %10s %10s %6s\n",
+      "model",
+      "triangles",
+      "acmr",
+      "opt acmr",
+      "atvr",
+      "opt atvr",
+      "cache ms",
+      "fetch ms",
+      "same"
+  );
+
+  for (const auto& path : models) {
+    const std::string name = std::filesystem::path(path).filename().string();
+    FlowfieldSettings settings{'A', 30.0f, threads};
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+    if (!ComputeUvFlowfieldFromOBJ(path, verts, indices, settings)) continue;
+    const size_t nV = verts.size() / 6;
+
+    std::vector<unsigned int> cacheIndices;
+    Timing tCache = measure(reps, [&] {
+      cacheIndices = indices;
+      OptimizeVertexCache(cacheIndices.data(), cacheIndices.size(), nV);
+    });
+
+    std::vector<float> fetchVerts;
+    std::vector<unsigned int> fetchIndices;
+    Timing tFetch = measure(reps, [&] {
+      fetchVerts = verts;
+      fetchIndices = cacheIndices;
+      OptimizeVertexFetch(fetchVerts, fetchIndices);
+    });
+
+    const VertexCacheStats before = AnalyzeVertexCache(indices.data(), indices.size(), nV);
+    const VertexCacheStats after = AnalyzeVertexCache(fetchIndices.data(), fetchIndices.size(), nV);
+    const bool same = canonicalTriangles(verts, indices) == canonicalTriangles(fetchVerts, fetchIndices);
+
+    std::printf(
+        "%-20s %10zu %8.3f %8.3f %8.3f %8.3f %10.3f %10.3f %6s\n",
+        name.c_str(),
+        indices.size() / 3,
+        before.acmr,
+        after.acmr,
+        before.atvr,
+        after.atvr,
+        tCache.medianMs,
+        tFetch.medianMs,
+        same ? "yes" : "NO"
+    );
+  }
+}
+
+// Compact vertex formats: GPU bytes vs. the float layout and the measured decode error per flow precision
+static void benchCompact(const std::vector<std::string>& models, int reps, int threads) {
+  std::printf(
+      "%-20s %5s %10s %10s %8s %10s %12s %12s %8s\n",
+      "model",
+      "flow",
+      "float KB",
+      "compact KB",
+      "ratio",
+      "ms",
+      "pos err rel",
+      "flow err deg",
+      "zero"
+  );
+
+  for (const auto& path : models) {
+    const std::string name = std::filesystem::path(path).filename().string();
+    FlowfieldSettings settings{'A', 30.0f, threads};
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+    if (!ComputeUvFlowfieldFromOBJ(path, verts, indices, settings)) continue;
+
+    const size_t floatBytes = verts.size() * sizeof(float) + indices.size() * sizeof(unsigned int);
+
+    for (int bits : {16, 8}) {
+      QuantizedFlowfieldMesh q;
+      Timing t = measure(reps, [&] {
+        QuantizeFlowfieldMesh(verts.data(), verts.size(), indices.data(), indices.size(), bits, q);
+      });
+
+      const size_t indexBytes = q.shortIndices.empty() ? indices.size() * sizeof(unsigned int)
+                                                       : q.shortIndices.size() * sizeof(uint16_t);
+      const size_t compactBytes = q.vertexData.size() + indexBytes;
+      const float diagonal = std::sqrt(
+          q.boundsExtent[0] * q.boundsExtent[0] + q.boundsExtent[1] * q.boundsExtent[1]
+          + q.boundsExtent[2] * q.boundsExtent[2]
+      );
+
+      std::printf(
+          "%-20s %5d %10.1f %10.1f %8.3f %10.3f %12.2e %12.5f %8zu\n",
+          name.c_str(),
+          bits,
+          floatBytes / 1024.0,
+          compactBytes / 1024.0,
+          (double)compactBytes / (double)floatBytes,
+          t.medianMs,
+          diagonal > 0.0f ? q.maxPositionError / diagonal : 0.0f,
+          q.maxFlowErrorDeg,
+          q.zeroFlows
+      );
+    }
+  }
+}
+
+// Bakes with and without the Morton reordering of the input, and the vertex cache behavior of the raw output
+static void benchMorton(const std::vector<std::string>& models, int reps, int threads) {
+  std::printf(
+      "%-20s %10s %10s %10s %8s %8s %8s %6s\n",
+      "model",
+      "reorder ms",
+      "bake ms",
+      "morton ms",
+      "speedup",
+      "acmr",
+      "m acmr",
+      "same"
+  );
+
+  for (const auto& path : models) {
+    const std::string name = std::filesystem::path(path).filename().string();
+    ObjPolys m;
+    if (!loadObjAsPolys(path, m, threads)) continue;
+
+    // The copy that gives every rep the file order again is timed on its own and taken out
+    ObjPolys reordered;
+    Timing tCopy = measure(reps, [&] { reordered = m; });
+    Timing tReorder = measure(reps, [&] {
+      reordered = m;
+      reorderPolysMorton(reordered, threads);
+    });
+
+    FlowfieldSettings settings{'A', 30.0f, threads};
+    std::vector<float> verts, mortonVerts;
+    std::vector<unsigned int> indices, mortonIndices;
+    Timing tBake = measure(reps, [&] { ComputeUvFlowfieldFromOBJ(path, verts, indices, settings); });
+    settings.spatialReorder = true;
+    Timing tMorton = measure(reps, [&] { ComputeUvFlowfieldFromOBJ(path, mortonVerts, mortonIndices, settings); });
+
+    const VertexCacheStats before = AnalyzeVertexCache(indices.data(), indices.size(), verts.size() / 6);
+    const VertexCacheStats after =
+        AnalyzeVertexCache(mortonIndices.data(), mortonIndices.size(), mortonVerts.size() / 6);
+    const bool same = canonicalTriangles(verts, indices) == canonicalTriangles(mortonVerts, mortonIndices);
+
+    std::printf(
+        "%-20s %10.3f %10.3f %10.3f %8.2f %8.3f %8.3f %6s\n",
+        name.c_str(),
+        std::max(tReorder.medianMs - tCopy.medianMs, 0.0),
+        tBake.medianMs,
+        tMorton.medianMs,
+        tMorton.medianMs > 0.0 ? tBake.medianMs / tMorton.medianMs : 0.0,
+        before.acmr,
+        after.acmr,
+        same ? "yes" : "NO"
+    );
+  }
+}
+
+// FNV-1a over the bytes, so equal checksums mean bit-identical buffers
+static uint64_t checksumBytes(const void* data, size_t bytes, uint64_t h = 1469598103934665603ull) {
+  const auto* p = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < bytes; ++i) h = (h ^ p[i]) * 1099511628211ull;
+  return h;
+}
+
+// Bakes every model with 1 to threads workers and checks that the output is bit-identical. Returns false on
+// a mismatch, the checksums can be compared across builds and machines.
+static bool benchChecksum(const std::vector<std::string>& models, int threads) {
+  struct Config {
+    const char* name;
+    FlowfieldSettings settings;
+  };
+  std::vector<Config> configs = {{"U", {'U', 0.0f}}, {"V crease", {'V', 30.0f}}, {"A crease", {'A', 30.0f}}};
+  Config all{"A all", {'A', 30.0f}};
+  all.settings.lodLevels = 3;
+  all.settings.optimizeDrawOrder = true;
+  all.settings.spatialReorder = true;
+  configs.push_back(all);
+
+  // The float geometry kernels are bit-identical, so whole bakes must be too. Reference (double) is not.
+  std::vector<GeometryKernel> kernels;
+  for (GeometryKernel k : {GeometryKernel::Scalar, GeometryKernel::Sse, GeometryKernel::Avx2}) {
+    if (geometryKernelSupported(k)) kernels.push_back(k);
+  }
+
+  std::printf("%-20s %-10s %18s %8s %8s %6s\n", "model", "settings", "checksum", "threads", "kernels", "same");
+
+  auto bakeChecksum = [](const std::string& path, const FlowfieldSettings& settings, uint64_t& h) {
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+    std::vector<FlowfieldLod> lods;
+    if (!ComputeUvFlowfieldFromOBJ(path, verts, indices, settings, &lods)) return false;
+
+    h = checksumBytes(verts.data(), verts.size() * sizeof(float));
+    h = checksumBytes(indices.data(), indices.size() * sizeof(unsigned int), h);
+    h = checksumBytes(lods.data(), lods.size() * sizeof(FlowfieldLod), h);
+    return true;
+  };
+
+  bool allSame = true;
+  for (const auto& path : models) {
+    const std::string name = std::filesystem::path(path).filename().string();
+    for (const Config& config : configs) {
+      uint64_t reference = 0;
+      bool same = true;
+      for (int t = 1; t <= std::max(threads, 2) && same; ++t) {
+        FlowfieldSettings settings = config.settings;
+        settings.threads = t;
+        uint64_t h = 0;
+        same = bakeChecksum(path, settings, h) && (t == 1 || h == reference);
+        if (t == 1) reference = h;
+      }
+
+      // Every kernel on the default kernel's thread count, after the loop above has checked that does not matter
+      for (size_t k = 0; k < kernels.size() && same; ++k) {
+        forceGeometryKernel(kernels[k]);
+        FlowfieldSettings settings = config.settings;
+        settings.threads = threads;
+        uint64_t h = 0;
+        same = bakeChecksum(path, settings, h) && h == reference;
+      }
+      forceGeometryKernel(std::nullopt);
+
+      allSame = allSame && same;
+      std::printf(
+          "%-20s %-10s %18.16llx %8d %8zu %6s\n",
+          name.c_str(),
+          config.name,
+          (unsigned long long)reference,
+          std::max(threads, 2),
+          kernels.size(),
+          same ? "yes" : "NO"
+      );
+    }
+  }
+  return allSame;
+}
+
+// OBJ of a synthetic mesh in the temp directory, written on first use from mesh or a fresh one. Empty when it
+// cannot be written.
+static std::string syntheticObj(const SyntheticMeshSettings& settings, const ObjPolys* mesh = nullptr) {
+  const auto dir = std::filesystem::temp_directory_path() / "flowfield_bench";
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+
+  std::string name = std::string(syntheticShapeName(settings.shape)) + "_" + std::to_string(settings.triangles);
+  if (settings.shape == SyntheticShape::Grid) name += "_i" + std::to_string(settings.islands);
+  const std::string path = (dir / (name + ".obj")).string();
+  if (std::filesystem::exists(path, ec)) return path;
+
+  // Written under a temporary name so an interrupted run leaves no partial file behind
+  const std::string tmpPath = path + ".tmp";
+  if (!writeObj(mesh ? *mesh : makeSyntheticMesh(settings), tmpPath)) return std::string();
+  std::filesystem::rename(tmpPath, path, ec);
+  return ec ? std::string() : path;
+}
+
+struct StageResult {
+  std::string mesh;
+  size_t triangles = 0;
+  const char* stage = "";
+  Timing t;
+};
+
+static void writeJsonString(FILE* f, const std::string& s) {
+  std::fputc('"', f);
+  for (char c : s) {
+    if (c == '"' || c == '\\') std::fputc('\\', f);
+    if ((unsigned char)c >= 0x20) std::fputc(c, f);
+  }
+  std::fputc('"', f);
+}
+
+static bool writeStageJson(const std::string& path, int reps, int threads, const std::vector<StageResult>& results) {
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    std::fprintf(stderr, "Failed to open %s\n", path.c_str());
+    return false;
+  }
+
+  std::fprintf(f, "{\"reps\":%d,\"warmup\":%d,\"threads\":%d,\"results\":[", reps, warmupRuns, threads);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const StageResult& r = results[i];
+    std::fputs(i ? ",\n{\"mesh\":" : "\n{\"mesh\":", f);
+    writeJsonString(f, r.mesh);
+    std::fprintf(
+        f,
+        ",\"triangles\":%zu,\"stage\":\"%s\",\"minMs\":%.4f,\"medianMs\":%.4f,\"p95Ms\":%.4f}",
+        r.triangles,
+        r.stage,
+        r.t.minMs,
+        r.t.medianMs,
+        r.t.p95Ms
+    );
+  }
+  std::fputs("\n]}\n", f);
+  return std::fclose(f) == 0;
+}
+
+// Every pipeline stage in isolation, each on the output of the previous ones, then the full bake with levels of
+// detail and draw order optimization. Runs on the models and on synthetic meshes written to the temp directory.
+// Stages that work in place time a copy of their input along with them.
+static bool benchStages(const std::vector<std::string>& models, int reps, int threads, const std::string& jsonPath) {
+  std::vector<SyntheticMeshSettings> synthetic;
+  for (size_t triangles : {32768, 131072, 524288}) synthetic.push_back({SyntheticShape::Grid, triangles});
+  for (SyntheticShape shape : {SyntheticShape::Sphere, SyntheticShape::Torus, SyntheticShape::HardSurface}) {
+    synthetic.push_back({shape, 131072});
+  }
+
+  std::vector<std::string> meshes = models;
+  for (const SyntheticMeshSettings& settings : synthetic) {
+    const std::string path = syntheticObj(settings);
+    if (!path.empty()) meshes.push_back(path);
+  }
+
+  std::printf("%-20s %10s %-16s %10s %10s %10s\n", "mesh", "triangles", "stage", "min ms", "median ms", "p95 ms");
+
+  std::vector<StageResult> results;
+  for (const auto& path : meshes) {
+    const std::string name = std::filesystem::path(path).filename().string();
+    ObjPolys m;
+    if (!loadObjAsPolys(path, m, threads)) {
+      std::printf("%-20s failed to load\n", name.c_str());
+      continue;
+    }
+
+    const std::vector<Tri> tris = triangulate(m);
+    auto run = [&](const char* stage, const std::function<void()>& fn) {
+      StageResult r{name, tris.size(), stage, measure(reps, fn)};
+      std::printf(
+          "%-20s %10zu %-16s %10.3f %10.3f %10.3f\n",
+          name.c_str(),
+          r.triangles,
+          stage,
+          r.t.minMs,
+          r.t.medianMs,
+          r.t.p95Ms
+      );
+      results.push_back(r);
+    };
+
+    run("load", [&] {
+      ObjPolys loaded;
+      loadObjAsPolys(path, loaded, threads);
+    });
+    run("morton", [&] {
+      ObjPolys reordered = m;
+      reorderPolysMorton(reordered, threads);
+    });
+    run("triangulate", [&] { triangulate(m); });
+
+    const MeshTopology topo = buildTopology(m, tris);
+    run("topology", [&] { buildTopology(m, tris); });
+
+    TriGeometry geom;
+    computeTriGeometry(m, tris, geom, threads);
+    run("geometry", [&] {
+      TriGeometry g;
+      computeTriGeometry(m, tris, g, threads);
+    });
+
+    const std::vector<int> polyIsland = computeFaceIslands(m, tris, topo, threads);
+    run("islands", [&] { computeFaceIslands(m, tris, topo, threads); });
+    const std::vector<UvIsland> islands = scoreIslandsAxis(m, geom, polyIsland, threads);
+    run("score islands", [&] { scoreIslandsAxis(m, geom, polyIsland, threads); });
+
+    const std::vector<uint8_t> creaseEdge = computeCreaseEdges(topo, geom, 30.0, threads);
+    run("crease edges", [&] { computeCreaseEdges(topo, geom, 30.0, threads); });
+    const SplitMesh split = buildSplitMesh(m, tris, topo, creaseEdge, 30.0, threads);
+    run("split", [&] { buildSplitMesh(m, tris, topo, creaseEdge, 30.0, threads); });
+    const int nV_out = (int)split.outPos.size();
+    const Csr<int> adj = buildAdjacencyVec(tris, topo, split.cornerOut, nV_out);
+    run("adjacency", [&] { buildAdjacencyVec(tris, topo, split.cornerOut, nV_out); });
+
+    std::vector<Eigen::Vector3d> vNormal, vTangent;
+    std::vector<double> vWeight;
+    auto accumulate = [&] {
+      accumulateNormalsAndTangents(
+          tris, polyIsland, islands, 'A', geom, split.cornerOut, nV_out, vNormal, vTangent, vWeight, threads
+      );
+    };
+    accumulate();
+    run("accumulate", accumulate);
+    const std::vector<Eigen::Vector3d> flow = buildFlowFromAccum(vNormal, vTangent, vWeight, adj, threads);
+    run("flow", [&] { buildFlowFromAccum(vNormal, vTangent, vWeight, adj, threads); });
+
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+    run("pack vertices", [&] { packInterleavedVertices(split.outPos, flow, verts, threads); });
+    run("pack indices", [&] { packTriangleIndices(m, split.cornerOut, indices); });
+
+    FlowfieldLodSettings lodSettings;
+    lodSettings.maxLevels = 3;
+    std::vector<unsigned int> lodIndices = indices;
+    const std::vector<FlowfieldLod> lods = BuildFlowfieldLods(verts, lodIndices, lodSettings);
+    run("lods", [&] {
+      std::vector<unsigned int> ind = indices;
+      BuildFlowfieldLods(verts, ind, lodSettings);
+    });
+    run("optimize", [&] {
+      std::vector<float> v = verts;
+      std::vector<unsigned int> ind = lodIndices;
+      OptimizeFlowfieldMesh(v, ind, lods);
+    });
+    QuantizedFlowfieldMesh q;
+    run("quantize", [&] { QuantizeFlowfieldMesh(verts.data(), verts.size(), indices.data(), indices.size(), 16, q); });
+
+    FlowfieldSettings settings{'A', 30.0f, threads};
+    settings.lodLevels = 3;
+    settings.optimizeDrawOrder = true;
+    run("bake", [&] {
+      std::vector<float> v;
+      std::vector<unsigned int> ind;
+      std::vector<FlowfieldLod> l;
+      ComputeUvFlowfieldFromOBJ(path, v, ind, settings, &l);
+    });
+  }
+
+  return jsonPath.empty() || writeStageJson(jsonPath, reps, threads, results);
+}
+
+// Full bakes of every synthetic shape from 1K triangles up to maxTriangles, then of one grid size with more and
+// more UV islands, for charting bake time and peak memory against mesh size and island count
+static void benchScaling(int reps, int threads, size_t maxTriangles) {
+  std::printf(
+      "%-8s %10s %8s %12s %10s %10s %10s\n",
+      "shape",
+      "triangles",
+      "islands",
+      "median ms",
+      "p95 ms",
+      "ns/tri",
+      "peak MB"
+  );
+
+  auto bake = [&](const SyntheticMeshSettings& synthetic) {
+    const ObjPolys m = makeSyntheticMesh(synthetic);
+    const std::vector<Tri> tris = triangulate(m);
+    const std::vector<int> polyIsland = computeFaceIslands(m, tris, buildTopology(m, tris), threads);
+    const int islands = polyIsland.empty() ? 0 : *std::max_element(polyIsland.begin(), polyIsland.end()) + 1;
+
+    const std::string path = syntheticObj(synthetic, &m);
+    if (path.empty()) return;
+
+    FlowfieldSettings settings{'A', 30.0f, threads};
+    std::vector<float> verts;
+    std::vector<unsigned int> indices;
+    FlowfieldMemoryReport report;
+    Timing t = measure(reps, [&] { ComputeUvFlowfieldFromOBJ(path, verts, indices, settings, nullptr, &report); });
+
+    std::printf(
+        "%-8s %10zu %8d %12.3f %10.3f %10.1f %10.1f\n",
+        syntheticShapeName(synthetic.shape),
+        tris.size(),
+        islands,
+        t.medianMs,
+        t.p95Ms,
+        t.medianMs * 1e6 / (double)std::max<size_t>(tris.size(), 1),
+        report.peakBytes / (1024.0 * 1024.0)
+    );
+  };
+
+  for (SyntheticShape shape :
+       {SyntheticShape::Grid, SyntheticShape::Sphere, SyntheticShape::Torus, SyntheticShape::HardSurface}) {
+    for (size_t triangles = 1000; triangles <= maxTriangles; triangles *= 10) bake({shape, triangles});
+  }
+  const size_t islandTriangles = std::min<size_t>(maxTriangles, 1000000);
+  for (int islands : {1, 4, 16, 64, 256}) bake({SyntheticShape::Grid, islandTriangles, islands});
+}
+
+static void printUsage() {
+  std::printf(
+      "usage: flowfield_bench <suite> [--reps N] [--warmup N] [--threads N] [--models DIR] [--json FILE]\n"
+      "                       [--max-triangles N]\n"
+      "suites:\n"
+      "  loader   OBJ loading, tinyobj vs. the mmap parser, exit code 1 when they disagree\n"
+      "  hash     hash table workloads of the pipeline stages, std vs. flat tables\n"
+      "  comps    buildFlowFromAccum on synthetic meshes with many small components\n"
+      "  geometry triangle geometry kernels, timed, validated against the double reference and required to match\n"
+      "           each other bit for bit, exit code 1 otherwise\n"
+      "  accum    normal and tangent accumulation per axis mode, double vs. float sums\n"
+      "  rebuild  FlowfieldBaker rebakes after settings changes vs. full bakes\n"
+      "  memory   bytes allocated and peak live bytes per pipeline stage\n"
+      "  stream   out-of-core bakes at shrinking memory limits vs. the in-memory bake\n"
+      "  lod      level of detail chains, build time and triangles and error per level\n"
+      "  order    vertex cache and fetch reordering, ACMR and ATVR before and after\n"
+      "  compact  quantized vertex and index formats, size and decode error\n"
+      "  morton   bakes with the input reordered along a Morton curve vs. file order\n"
+      "  checksum output checksums, bit-identical for 1 to N threads and for every float geometry kernel,\n"
+      "           exit code 1 otherwise\n"
+      "  stages   every pipeline stage in isolation and the full bake, min/median/p95, --json writes the results\n"
+      "  scaling  full bakes of synthetic meshes from 1K to --max-triangles (default 1M) and growing island counts\n"
+  );
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printUsage();
+    return 1;
+  }
+
+  const std::string suite = argv[1];
+  int reps = 5;
+  int threads = 0;
+  std::string modelDir = "assets/models";
+  std::string jsonPath;
+  size_t maxTriangles = 1000000;
+
+  for (int i = 2; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--reps") && i + 1 < argc) reps = std::max(1, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--warmup") && i + 1 < argc) warmupRuns = std::max(0, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) threads = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--models") && i + 1 < argc) modelDir = argv[++i];
+    else if (!std::strcmp(argv[i], "--json") && i + 1 < argc) jsonPath = argv[++i];
+    else if (!std::strcmp(argv[i], "--max-triangles") && i + 1 < argc) maxTriangles = (size_t)std::atoll(argv[++i]);
+    else {
+      printUsage();
+      return 1;
+    }
+  }
+
+  threads = resolveThreadCount(threads);
+  const auto models = findModels(modelDir);
+  std::printf("suite %s, %d reps, %d threads, %zu models\n\n", suite.c_str(), reps, threads, models.size());
+
+  if (suite == "loader") {
+    if (!benchLoader(models, reps, threads)) return 1;
+  } else if (suite == "hash") {
+    benchHash(models, reps, threads);
+  } else if (suite == "comps") {
+    benchComponents(reps, threads);
+  } else if (suite == "geometry") {
+    if (!benchGeometry(models, reps, threads)) return 1;
+  } else if (suite == "accum") {
+    benchAccumulate(models, reps, threads);
+  } else if (suite == "rebuild") {
+    benchRebuild(models, reps, threads);
+  } else if (suite == "memory") {
+    benchMemory(models, threads);
+  } else if (suite == "stream") {
+    benchStream(models, reps, threads);
+  } else if (suite == "lod") {
+    benchLod(models, reps, threads);
+  } else if (suite == "order") {
+    benchDrawOrder(models, reps, threads);
+  } else if (suite == "compact") {
+    benchCompact(models, reps, threads);
+  } else if (suite == "morton") {
+    benchMorton(models, reps, threads);
+  } else if (suite == "checksum") {
+    if (!benchChecksum(models, threads)) return 1;
+  } else if (suite == "stages") {
+    if (!benchStages(models, reps, threads, jsonPath)) return 1;
+  } else if (suite == "scaling") {
+    benchScaling(reps, threads, maxTriangles);
+  } else {
+    printUsage();
+    return 1;
+  }
+
+  return 0;
+}
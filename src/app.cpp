@@ -1,5 +1,6 @@
 #include "app.hpp"
 
+#include "flowfield/trace.hpp"
 #include "framebuffer.hpp"
 #include "mesh.hpp"
 #include "util.hpp"
@@ -10,7 +11,11 @@
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 
+#include <iostream>
+
 App::App() {
+  trace::SetThreadName("main");
+
   InitWindow();
 
   InitOpenGL();
@@ -27,6 +32,7 @@ void App::Run() {
       glfwWaitEvents();
       continue;
     }
+    TRACE_ZONE("Frame");
     float dt = ImGui::GetIO().DeltaTime;
 
     ImGui_ImplOpenGL3_NewFrame();
@@ -152,6 +158,18 @@ void App::UpdateImGui() {
     if (ImGui::CollapsingHeader("Screenshot", ImGuiTreeNodeFlags_DefaultOpen)) {
       screenshot.UpdateImGui();
     }
+
+    if (ImGui::CollapsingHeader("Profiling")) {
+      bool recording = trace::IsEnabled();
+      if (ImGui::Checkbox("Record trace", &recording)) trace::SetEnabled(recording);
+      ImGui::SameLine();
+      if (ImGui::Button("Save trace")) {
+        const int events = trace::WriteChromeTrace("trace.json");
+        if (events >= 0) std::cout << "Saved " << events << " trace events to trace.json" << std::endl;
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Clear trace")) trace::Clear();
+    }
   }
   ImGui::End();
 }
@@ -1,5 +1,7 @@
 #include "effect.hpp"
 
+#include "flowfield/trace.hpp"
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -61,6 +63,7 @@ void Effect::Apply(Framebuffer& in, float dt) {
 }
 
 void Effect::ScatterPass(Framebuffer& in, float dt, const MvpState* mats) {
+  TRACE_ZONE("Effect::ScatterPass");
   assert(in.tex.internalFormat == GL_RG16F);
 
   if (accResetInterval > 0) {
@@ -100,6 +103,7 @@ void Effect::ScatterPass(Framebuffer& in, float dt, const MvpState* mats) {
 }
 
 void Effect::FillPass() {
+  TRACE_ZONE("Effect::FillPass");
   fillShader.Use();
 
   fillShader.SetImage("uCurrNoiseTex", currNoiseTex, 0, GL_READ_WRITE);
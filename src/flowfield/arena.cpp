@@ -0,0 +1,62 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace flowfield::detail {
+
+  Arena::Arena(size_t blockSize): blockSize(std::max<size_t>(blockSize, 4096)) {}
+
+  Arena::~Arena() {
+    freeBlocks();
+  }
+
+  void Arena::reset() {
+    if (blocks.size() > 1) {
+      const size_t total = reserved;
+      freeBlocks();
+      addBlock(total);
+    }
+    current = 0;
+    used = 0;
+    allocated = 0;
+  }
+
+  void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    for (;;) {
+      if (current < blocks.size()) {
+        const Block& b = blocks[current];
+        const uintptr_t base = (uintptr_t)b.data;
+        const uintptr_t aligned = (base + used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        const size_t end = (size_t)(aligned - base) + bytes;
+        if (end <= b.size) {
+          used = end;
+          allocated += bytes;
+          return (void*)aligned;
+        }
+        if (current + 1 < blocks.size()) {
+          current++;
+          used = 0;
+          continue;
+        }
+      }
+      addBlock(bytes + alignment);
+      current = blocks.size() - 1;
+      used = 0;
+    }
+  }
+
+  void Arena::addBlock(size_t minBytes) {
+    const size_t size = std::max(blockSize, minBytes);
+    blocks.push_back(Block{static_cast<std::byte*>(::operator new(size)), size});
+    reserved += size;
+  }
+
+  void Arena::freeBlocks() {
+    for (const Block& b : blocks) ::operator delete(b.data);
+    blocks.clear();
+    reserved = 0;
+  }
+
+} // namespace flowfield::detail
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace flowfield::detail {
+
+  // Monotonic arena for the temporaries of the bake stages: allocation bumps a pointer, deallocation does
+  // nothing and reset() makes everything reusable at once. After a reset the blocks are merged into one, so
+  // a rebake of the same size allocates nothing new. Not thread-safe: only the baking thread allocates from
+  // it, parallel workers write into buffers sized up front.
+  class Arena final : public std::pmr::memory_resource {
+  public:
+    explicit Arena(size_t blockSize = size_t(1) << 20);
+    ~Arena() override;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void reset();
+
+    size_t allocatedBytes() const { return allocated; } // requested since the last reset
+    size_t reservedBytes() const { return reserved; }   // held in blocks
+
+  private:
+    struct Block {
+      std::byte* data;
+      size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    void addBlock(size_t minBytes);
+    void freeBlocks();
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t current = 0; // block being filled
+    size_t used = 0;    // bytes used in it
+    size_t allocated = 0;
+    size_t reserved = 0;
+  };
+
+} // namespace flowfield::detail
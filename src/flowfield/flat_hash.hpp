@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace flowfield::detail {
+
+  // Insert-only open-addressing hash map with linear probing over a power-of-two slot array.
+  // Keys and values are stored inline, empty slots hold emptyKey (which must never be inserted).
+  // Sized up front from known element counts; grows by doubling above 50% load.
+  template<typename K, typename V, typename Hash>
+  class FlatHashMap {
+  public:
+    struct Slot {
+      K key;
+      V value;
+    };
+
+    explicit FlatHashMap(
+        const K& emptyKey,
+        size_t expected = 0,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+    ):
+      emptyKey(emptyKey),
+      slots(resource) {
+      reserve(expected);
+    }
+
+    void reserve(size_t expected) {
+      size_t cap = 16;
+      while (cap < expected * 2) cap <<= 1;
+      if (cap > slots.size()) rehash(cap);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Inserts (key, value) unless key is present. Returns the stored value and whether it was inserted.
+    std::pair<V*, bool> tryEmplace(const K& key, const V& value) {
+      if ((count + 1) * 2 > slots.size()) rehash(slots.size() * 2);
+
+      size_t i = Hash()(key) & mask;
+      while (!(slots[i].key == emptyKey)) {
+        if (slots[i].key == key) return {&slots[i].value, false};
+        i = (i + 1) & mask;
+      }
+      slots[i] = Slot{key, value};
+      count++;
+      return {&slots[i].value, true};
+    }
+
+    V* find(const K& key) {
+      return const_cast<V*>(static_cast<const FlatHashMap*>(this)->find(key));
+    }
+
+    const V* find(const K& key) const {
+      size_t i = Hash()(key) & mask;
+      while (!(slots[i].key == emptyKey)) {
+        if (slots[i].key == key) return &slots[i].value;
+        i = (i + 1) & mask;
+      }
+      return nullptr;
+    }
+
+    bool contains(const K& key) const { return find(key) != nullptr; }
+
+    template<typename Fn>
+    void forEach(Fn&& fn) const {
+      for (const Slot& s : slots) {
+        if (!(s.key == emptyKey)) fn(s.key, s.value);
+      }
+    }
+
+  private:
+    void rehash(size_t cap) {
+      std::pmr::vector<Slot> old = std::move(slots);
+      slots.assign(cap, Slot{emptyKey, V()});
+      mask = cap - 1;
+
+      for (const Slot& s : old) {
+        if (s.key == emptyKey) continue;
+        size_t i = Hash()(s.key) & mask;
+        while (!(slots[i].key == emptyKey)) i = (i + 1) & mask;
+        slots[i] = s;
+      }
+    }
+
+    K emptyKey;
+    std::pmr::vector<Slot> slots;
+    size_t mask = 0;
+    size_t count = 0;
+  };
+
+  template<typename K, typename Hash>
+  class FlatHashSet {
+  public:
+    explicit FlatHashSet(const K& emptyKey, size_t expected = 0): map(emptyKey, expected) {}
+
+    void reserve(size_t expected) { map.reserve(expected); }
+    size_t size() const { return map.size(); }
+    bool empty() const { return map.empty(); }
+
+    bool insert(const K& key) { return map.tryEmplace(key, 0).second; }
+    bool contains(const K& key) const { return map.contains(key); }
+
+    template<typename Fn>
+    void forEach(Fn&& fn) const {
+      map.forEach([&](const K& key, uint8_t) { fn(key); });
+    }
+
+  private:
+    FlatHashMap<K, uint8_t, Hash> map;
+  };
+
+} // namespace flowfield::detail
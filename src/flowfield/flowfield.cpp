@@ -1,51 +1,239 @@
 // code generated by AI
 #include "flowfield.hpp"
 
+#include "arena.hpp"
 #include "flowfield_detail.hpp"
+#include "flowfield_lod.hpp"
+#include "flowfield_optimize.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include "tri_geometry.hpp"
 
-bool ComputeUvFlowfieldFromOBJ(
+#include <algorithm>
+#include <filesystem>
+
+using namespace flowfield::detail;
+
+// Bytes of the heap blocks behind the pipeline's buffers, for the memory report
+template<typename T>
+static size_t heapBytes(const std::vector<T>& v) {
+  return v.capacity() * sizeof(T);
+}
+
+template<typename T>
+static size_t heapBytes(const Csr<T>& c) {
+  return heapBytes(c.offset) + heapBytes(c.items);
+}
+
+static size_t heapBytes(const ObjPolys& m) {
+  const auto& a = m.attrib;
+  return heapBytes(a.vertices) + heapBytes(a.normals) + heapBytes(a.texcoords) + heapBytes(m.polys);
+}
+
+static size_t heapBytes(const MeshTopology& t) {
+  return heapBytes(t.edgeOf) + heapBytes(t.ringNext) + heapBytes(t.polyEdge) + heapBytes(t.edgeHalf)
+       + heapBytes(t.vertexTris);
+}
+
+static size_t heapBytes(const TriGeometry& g) {
+  return heapBytes(g.nx) + heapBytes(g.ny) + heapBytes(g.nz) + heapBytes(g.area) + heapBytes(g.ux) + heapBytes(g.uy)
+       + heapBytes(g.uz) + heapBytes(g.vx) + heapBytes(g.vy) + heapBytes(g.vz);
+}
+
+static size_t heapBytes(const std::vector<UvIsland>& islands) {
+  size_t bytes = islands.capacity() * sizeof(UvIsland);
+  for (const UvIsland& isl : islands) bytes += heapBytes(isl.faceIds);
+  return bytes;
+}
+
+struct FlowfieldBaker::State {
+  // Scratch memory of the stages, handed on to the next state when the file changes
+  std::unique_ptr<Arena> arena = std::make_unique<Arena>();
+
+  // Identity of the loaded file
+  std::string path;
+  std::filesystem::file_time_type writeTime;
+  uintmax_t fileSize = 0;
+  bool spatialReorder = false;
+
+  // Depends on the file only
+  ObjPolys mesh;
+  std::vector<Tri> tris;
+  MeshTopology topo;
+  TriGeometry geom;
+
+  bool hasIslands = false;
+  std::vector<int> polyIsland;
+  std::vector<UvIsland> islands;
+
+  // Depends on the crease angle
+  bool hasSplit = false;
+  float creaseAngle = 0.0f;
+  SplitMesh split;
+  Csr<int> adj;
+
+  // Depends on the crease angle, the axis and the precision
+  bool hasFlow = false;
+  char axis = 0;
+  bool singlePrecision = false;
+  std::vector<Eigen::Vector3d> flow;
+
+  size_t keptBytes() const {
+    return heapBytes(mesh) + heapBytes(tris) + heapBytes(topo) + heapBytes(geom) + heapBytes(polyIsland)
+         + heapBytes(islands) + heapBytes(split.outPos) + heapBytes(split.cornerOut) + heapBytes(adj)
+         + heapBytes(flow);
+  }
+};
+
+FlowfieldBaker::FlowfieldBaker() = default;
+FlowfieldBaker::~FlowfieldBaker() = default;
+FlowfieldBaker::FlowfieldBaker(FlowfieldBaker&&) noexcept = default;
+FlowfieldBaker& FlowfieldBaker::operator=(FlowfieldBaker&&) noexcept = default;
+
+void FlowfieldBaker::Clear() {
+  state.reset();
+}
+
+bool FlowfieldBaker::Bake(
     const std::string& objPath,
     std::vector<float>& outVert,
     std::vector<unsigned int>& outInd,
-    const FlowfieldSettings& settings
+    const FlowfieldSettings& settings,
+    std::vector<FlowfieldLod>* outLods,
+    FlowfieldMemoryReport* outMemory,
+    FlowfieldDrawOrderStats* outDrawOrder
 ) {
-  using namespace flowfield::detail;
+  TRACE_ZONE("FlowfieldBaker::Bake");
+  const int threads = resolveThreadCount(settings.threads);
+  if (outMemory) *outMemory = FlowfieldMemoryReport();
 
-  ObjPolys mesh;
-  if (!loadObjAsPolys(objPath, mesh)) return false;
+  std::error_code ec;
+  const auto writeTime = std::filesystem::last_write_time(objPath, ec);
+  const uintmax_t fileSize = ec ? 0 : std::filesystem::file_size(objPath, ec);
+  const bool sameFile = state && !ec && state->path == objPath && state->writeTime == writeTime
+                     && state->fileSize == fileSize && state->spatialReorder == settings.spatialReorder;
 
-  std::vector<int> polyIsland;
-  std::vector<UvIsland> islands;
-  if (settings.axis == 'A') {
-    auto neighbors = buildUvNeighbors(mesh);
-    polyIsland = computeFaceIslandsBfs(neighbors);
-    islands = scoreIslandsAxis(mesh, polyIsland);
+  // Records a stage that just ran, liveBytes are its heap temporaries outside the arena, and makes the
+  // arena's memory reusable for the next stage
+  auto endStage = [&](State& st, const char* name, size_t liveBytes = 0) {
+    if (outMemory) {
+      FlowfieldStageMemory m;
+      m.stage = name;
+      m.scratchBytes = st.arena->allocatedBytes();
+      m.keptBytes = st.keptBytes() + heapBytes(outVert) + heapBytes(outInd) + (outLods ? heapBytes(*outLods) : 0);
+      m.peakBytes = m.keptBytes + m.scratchBytes + liveBytes;
+      outMemory->stages.push_back(m);
+      outMemory->peakBytes = std::max(outMemory->peakBytes, m.peakBytes);
+      outMemory->arenaReservedBytes = st.arena->reservedBytes();
+    }
+    st.arena->reset();
+  };
+
+  if (!sameFile) {
+    auto s = std::make_unique<State>();
+    if (state) s->arena = std::move(state->arena);
+    state.reset();
+    if (!loadObjAsPolys(objPath, s->mesh, threads)) return false;
+    if (settings.spatialReorder) reorderPolysMorton(s->mesh, threads);
+    endStage(*s, "load");
+
+    s->path = objPath;
+    s->writeTime = writeTime;
+    s->fileSize = fileSize;
+    s->spatialReorder = settings.spatialReorder;
+    s->tris = triangulate(s->mesh);
+    endStage(*s, "triangulate");
+    s->topo = buildTopology(s->mesh, s->tris, s->arena.get());
+    endStage(*s, "topology");
+    computeTriGeometry(s->mesh, s->tris, s->geom, threads);
+    endStage(*s, "geometry");
+    state = std::move(s);
   }
 
-  auto tris = triangulate(mesh);
+  State& s = *state;
+  Arena* scratch = s.arena.get();
 
-  std::vector<Eigen::Vector3d> triN;
-  std::vector<double> triA;
-  computeTriNormalsAndAreas(mesh, tris, triN, triA);
+  if (settings.axis == 'A' && !s.hasIslands) {
+    s.polyIsland = computeFaceIslands(s.mesh, s.tris, s.topo, threads, scratch);
+    s.islands = scoreIslandsAxis(s.mesh, s.geom, s.polyIsland, threads);
+    s.hasIslands = true;
+    endStage(s, "islands");
+  }
 
-  auto edgeToTris = buildEdgeToTris(tris);
-  auto creaseEdges = computeCreaseEdges(edgeToTris, triN, settings.creaseThresholdAngle);
+  if (!s.hasSplit || s.creaseAngle != settings.creaseThresholdAngle) {
+    auto creaseEdge = computeCreaseEdges(s.topo, s.geom, settings.creaseThresholdAngle, threads);
 
-  SplitMesh split = buildSplitMesh(mesh, tris, creaseEdges, settings.creaseThresholdAngle);
-  const int nV_out = (int)split.outPos.size();
+    s.split = buildSplitMesh(s.mesh, s.tris, s.topo, creaseEdge, settings.creaseThresholdAngle, threads, scratch);
+    s.adj = buildAdjacencyVec(s.tris, s.topo, s.split.cornerOut, (int)s.split.outPos.size(), scratch);
+    s.creaseAngle = settings.creaseThresholdAngle;
+    s.hasSplit = true;
+    s.hasFlow = false;
+    endStage(s, "split", heapBytes(creaseEdge));
+  }
 
-  auto adj = buildAdjacencyVec(split.outFaces, nV_out);
+  if (!s.hasFlow || s.axis != settings.axis || s.singlePrecision != settings.singlePrecision) {
+    std::vector<Eigen::Vector3d> vNormal, vTangent;
+    std::vector<double> vWeight;
+    accumulateNormalsAndTangents(
+        s.tris,
+        s.polyIsland,
+        s.islands,
+        settings.axis,
+        s.geom,
+        s.split.cornerOut,
+        (int)s.split.outPos.size(),
+        vNormal,
+        vTangent,
+        vWeight,
+        threads,
+        settings.singlePrecision,
+        scratch
+    );
+    const size_t accumBytes = heapBytes(vNormal) + heapBytes(vTangent) + heapBytes(vWeight);
+    endStage(s, "accumulate", accumBytes);
 
-  std::vector<Eigen::Vector3d> vNormal, vTangent;
-  std::vector<double> vWeight;
-  accumulateNormalsAndTangents(
-      mesh, tris, polyIsland, islands, settings.axis, triN, triA, split.polyOutCorner, nV_out, vNormal, vTangent, vWeight
-  );
+    s.flow = buildFlowFromAccum(vNormal, vTangent, vWeight, s.adj, threads, scratch);
+    s.axis = settings.axis;
+    s.singlePrecision = settings.singlePrecision;
+    s.hasFlow = true;
+    endStage(s, "flow", accumBytes);
+  }
+
+  packInterleavedVertices(s.split.outPos, s.flow, outVert, threads);
+  packTriangleIndices(s.mesh, s.split.cornerOut, outInd);
+  endStage(s, "pack");
 
-  auto outFlow = buildFlowFromAccum(vNormal, vTangent, vWeight, adj);
+  if (outLods) {
+    FlowfieldLodSettings lodSettings;
+    lodSettings.maxLevels = settings.lodLevels;
+    *outLods = BuildFlowfieldLods(outVert, outInd, lodSettings);
+    endStage(s, "lods");
+  }
 
-  packInterleavedVertices(split.outPos, outFlow, outVert);
-  packTriangleIndices(split.polyOutCorner, outInd);
+  if (settings.optimizeDrawOrder) {
+    const FlowfieldDrawOrderStats drawOrder =
+        OptimizeFlowfieldMesh(outVert, outInd, outLods ? *outLods : std::vector<FlowfieldLod>());
+    if (outDrawOrder) *outDrawOrder = drawOrder;
+    endStage(s, "optimize");
+  } else if (outDrawOrder) {
+    const size_t lodCount = outLods ? outLods->size() : 0;
+    const FlowfieldLod* lods = outLods ? outLods->data() : nullptr;
+    outDrawOrder->before = AnalyzeFlowfieldMesh(outInd.data(), outInd.size(), outVert.size() / 6, lods, lodCount);
+    outDrawOrder->after = outDrawOrder->before;
+  }
 
   return true;
 }
+
+bool ComputeUvFlowfieldFromOBJ(
+    const std::string& objPath,
+    std::vector<float>& outVert,
+    std::vector<unsigned int>& outInd,
+    const FlowfieldSettings& settings,
+    std::vector<FlowfieldLod>* outLods,
+    FlowfieldMemoryReport* outMemory,
+    FlowfieldDrawOrderStats* outDrawOrder
+) {
+  FlowfieldBaker baker;
+  return baker.Bake(objPath, outVert, outInd, settings, outLods, outMemory, outDrawOrder);
+}
@@ -2,17 +2,97 @@
 
 #define _USE_MATH_DEFINES
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 struct FlowfieldSettings {
   char axis = 'V';
   float creaseThresholdAngle = 0.0;
+  int threads = 0;   // worker threads for the bake, 0 = all hardware threads (does not affect the result)
+  int lodLevels = 0; // simplified levels of detail to build when the caller asks for them, see flowfield_lod.hpp
+  bool optimizeDrawOrder = false; // reorder the output for the vertex cache and fetch, see flowfield_optimize.hpp
+  bool spatialReorder = false;    // renumber the input along a Morton curve before the pipeline runs
+  bool singlePrecision = false;   // accumulate normals and tangents in float, see accumulateNormalsAndTangents
 };
 
+// One level of detail. All levels share the vertex buffer and index their own range of the index buffer.
+struct FlowfieldLod {
+  uint32_t indexOffset = 0;
+  uint32_t indexCount = 0;
+  float error = 0.0f; // approximate deviation from the full mesh in model units, 0 for the full mesh
+};
+
+// Post-transform vertex cache efficiency of an index range, measured with a FIFO cache
+struct VertexCacheStats {
+  float acmr = 0.0f; // transformed vertices per triangle, 0.5 is ideal for large regular meshes
+  float atvr = 0.0f; // transformed vertices per referenced vertex, 1.0 is ideal
+};
+
+// Vertex cache efficiency of the full mesh in the bake's order and in the final order. Both are the same
+// without optimizeDrawOrder.
+struct FlowfieldDrawOrderStats {
+  VertexCacheStats before;
+  VertexCacheStats after;
+};
+
+// Memory of one pipeline stage that ran in a bake
+struct FlowfieldStageMemory {
+  const char* stage = "";
+  size_t scratchBytes = 0; // temporaries the stage allocated from the bake arena
+  size_t keptBytes = 0;    // kept stages and output after the stage
+  size_t peakBytes = 0;    // keptBytes + scratchBytes, the most the stage had live at once
+};
+
+// Stages skipped because their kept results were still valid have no entry. Counts the heap blocks of the
+// pipeline's buffers, not allocator overhead, the loader's file mapping or the temporaries of the lods and
+// optimize stages, which do not use the arena.
+struct FlowfieldMemoryReport {
+  std::vector<FlowfieldStageMemory> stages;
+  size_t peakBytes = 0;          // largest peakBytes of the stages
+  size_t arenaReservedBytes = 0; // memory the bake arena holds for the next bake
+};
+
+// With outLods, the levels of detail from settings.lodLevels are appended to outInd and described in outLods.
+// With outMemory, the bytes allocated and the peak live bytes of every stage are reported there.
+// With outDrawOrder, the vertex cache efficiency before and after the draw order optimization is reported there.
 bool ComputeUvFlowfieldFromOBJ(
     const std::string& objPath,
     std::vector<float>& outVert,
     std::vector<unsigned int>& outInd,
-    const FlowfieldSettings& settings
+    const FlowfieldSettings& settings,
+    std::vector<FlowfieldLod>* outLods = nullptr,
+    FlowfieldMemoryReport* outMemory = nullptr,
+    FlowfieldDrawOrderStats* outDrawOrder = nullptr
 );
+
+// Bakes flowfields and keeps the intermediate pipeline stages of the last OBJ, so baking the same file again
+// with different settings only reruns what they invalidate: an axis or precision change reruns the tangent
+// accumulation and flow, a crease angle change reruns crease detection onward. The file is reloaded when its
+// path, size or modification time or spatialReorder changes. The stages' temporaries come from an arena the
+// baker keeps between bakes. Not thread-safe, use one baker per thread.
+class FlowfieldBaker {
+public:
+  FlowfieldBaker();
+  ~FlowfieldBaker();
+  FlowfieldBaker(FlowfieldBaker&&) noexcept;
+  FlowfieldBaker& operator=(FlowfieldBaker&&) noexcept;
+
+  bool Bake(
+      const std::string& objPath,
+      std::vector<float>& outVert,
+      std::vector<unsigned int>& outInd,
+      const FlowfieldSettings& settings,
+      std::vector<FlowfieldLod>* outLods = nullptr,
+      FlowfieldMemoryReport* outMemory = nullptr,
+      FlowfieldDrawOrderStats* outDrawOrder = nullptr
+  );
+
+  // Drops all kept stages
+  void Clear();
+
+private:
+  struct State;
+  std::unique_ptr<State> state;
+};
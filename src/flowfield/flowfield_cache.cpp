@@ -0,0 +1,300 @@
+#include "flowfield_cache.hpp"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+static constexpr char cacheMagic[8] = {'N', 'O', 'I', 'C', 'E', 'F', 'F', '\0'};
+// Bump whenever the baked output changes so older entries are treated as stale
+static constexpr uint32_t cacheVersion = 6;
+static constexpr uint64_t payloadAlign = 64;
+
+// All offsets are relative to the start of the file, payload arrays are aligned to payloadAlign.
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t objHash;
+  uint64_t settingsHash;
+  uint64_t vertFloatCount;
+  uint64_t indexCount;
+  uint64_t vertOffset;
+  uint64_t indexOffset;
+  uint64_t lodCount;
+  uint64_t lodOffset;
+  uint64_t payloadHash;
+};
+
+static_assert(sizeof(FlowfieldLod) == 12, "FlowfieldLod is stored as is");
+
+// MurmurHash64A
+static uint64_t hashBytes(const void* data, size_t len, uint64_t seed = 0) {
+  constexpr uint64_t m = 0xc6a4a7935bd1e995ULL;
+  constexpr int r = 47;
+
+  const unsigned char* p = (const unsigned char*)data;
+  uint64_t h = seed ^ (len * m);
+
+  const size_t nblocks = len / 8;
+  for (size_t i = 0; i < nblocks; ++i) {
+    uint64_t k;
+    std::memcpy(&k, p + i * 8, 8);
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  const unsigned char* tail = p + nblocks * 8;
+  uint64_t t = 0;
+  for (size_t i = 0; i < (len & 7); ++i) t |= (uint64_t)tail[i] << (8 * i);
+  if (len & 7) {
+    h ^= t;
+    h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+static uint64_t hashSettings(const FlowfieldSettings& settings, FlowfieldCacheLayout layout) {
+  uint32_t creaseBits;
+  std::memcpy(&creaseBits, &settings.creaseThresholdAngle, sizeof(creaseBits));
+  // The streaming bake ignores the output options, so they do not split its entries
+  const bool streamed = layout == FlowfieldCacheLayout::Streamed;
+  // One word per field, so no value can spill into another field's bits
+  const uint64_t fields[] = {
+      cacheVersion,
+      (unsigned char)settings.axis,
+      creaseBits,
+      streamed ? 0u : (uint32_t)settings.lodLevels,
+      settings.singlePrecision,
+      !streamed && settings.spatialReorder,
+      !streamed && settings.optimizeDrawOrder,
+      streamed,
+  };
+  return hashBytes(fields, sizeof(fields));
+}
+
+static uint64_t hashPayload(
+    const float* verts,
+    size_t vertFloatCount,
+    const unsigned int* indices,
+    size_t indexCount,
+    const FlowfieldLod* lods,
+    size_t lodCount
+) {
+  uint64_t h = hashBytes(verts, vertFloatCount * sizeof(float));
+  h = hashBytes(indices, indexCount * sizeof(unsigned int), h);
+  return hashBytes(lods, lodCount * sizeof(FlowfieldLod), h);
+}
+
+static int processId() {
+#ifdef _WIN32
+  return _getpid();
+#else
+  return (int)getpid();
+#endif
+}
+
+static uint64_t alignUp(uint64_t x) {
+  return (x + payloadAlign - 1) & ~(payloadAlign - 1);
+}
+
+static bool validateEntry(const MappedFile& file, uint64_t objHash, uint64_t settingsHash, FlowfieldCacheEntry& out) {
+  if (file.size < sizeof(CacheHeader)) return false;
+
+  CacheHeader h;
+  std::memcpy(&h, file.data, sizeof(h));
+
+  if (std::memcmp(h.magic, cacheMagic, sizeof(cacheMagic)) != 0) return false;
+  if (h.version != cacheVersion || h.headerSize != sizeof(CacheHeader)) return false;
+  if (h.objHash != objHash || h.settingsHash != settingsHash) return false;
+  if (h.vertFloatCount == 0 || h.vertFloatCount % 6 != 0 || h.indexCount == 0 || h.indexCount % 3 != 0) return false;
+  if (h.vertFloatCount > file.size || h.indexCount > file.size || h.lodCount > file.size) return false;
+
+  const uint64_t vertBytes = h.vertFloatCount * sizeof(float);
+  const uint64_t indexBytes = h.indexCount * sizeof(unsigned int);
+  const uint64_t lodBytes = h.lodCount * sizeof(FlowfieldLod);
+  if (h.vertOffset % payloadAlign != 0 || h.indexOffset % payloadAlign != 0) return false;
+  if (h.lodOffset % payloadAlign != 0) return false;
+  if (h.vertOffset < sizeof(CacheHeader) || h.vertOffset + vertBytes > h.indexOffset) return false;
+  if (h.indexOffset + indexBytes > h.lodOffset || h.lodOffset + lodBytes > file.size) return false;
+
+  const float* verts = (const float*)(file.data + h.vertOffset);
+  const unsigned int* indices = (const unsigned int*)(file.data + h.indexOffset);
+  const FlowfieldLod* lods = (const FlowfieldLod*)(file.data + h.lodOffset);
+  const size_t lodCount = (size_t)h.lodCount;
+  if (hashPayload(verts, (size_t)h.vertFloatCount, indices, (size_t)h.indexCount, lods, lodCount) != h.payloadHash) {
+    return false;
+  }
+
+  for (size_t i = 0; i < lodCount; ++i) {
+    const FlowfieldLod& l = lods[i];
+    if (l.indexOffset % 3 != 0 || l.indexCount % 3 != 0 || l.indexOffset + (uint64_t)l.indexCount > h.indexCount) {
+      return false;
+    }
+  }
+
+  out.verts = verts;
+  out.vertFloatCount = (size_t)h.vertFloatCount;
+  out.indices = indices;
+  out.indexCount = (size_t)h.indexCount;
+  out.lods = lodCount > 0 ? lods : nullptr;
+  out.lodCount = lodCount;
+  return true;
+}
+
+uint64_t HashFileContents(const std::string& path, bool* ok) {
+  MappedFile file;
+  bool opened = file.Open(path);
+  if (ok) *ok = opened;
+  if (!opened) return 0;
+  return hashBytes(file.data, file.size);
+}
+
+std::string GetFlowfieldCachePath(
+    uint64_t objHash, const FlowfieldSettings& settings, FlowfieldCacheLayout layout, const std::string& cacheDir
+) {
+  const uint64_t h = hashBytes(&objHash, sizeof(objHash), hashSettings(settings, layout));
+
+  char name[21];
+  std::snprintf(name, sizeof(name), "%016llx.ffc", (unsigned long long)h);
+  return (std::filesystem::path(cacheDir) / name).string();
+}
+
+bool LoadFlowfieldCache(
+    uint64_t objHash,
+    const FlowfieldSettings& settings,
+    FlowfieldCacheLayout layout,
+    FlowfieldCacheEntry& out,
+    const std::string& cacheDir
+) {
+  out = FlowfieldCacheEntry();
+
+  const std::string cachePath = GetFlowfieldCachePath(objHash, settings, layout, cacheDir);
+  if (!out.file.Open(cachePath)) return false;
+
+  if (!validateEntry(out.file, objHash, hashSettings(settings, layout), out)) {
+    std::cerr << "Discarding stale flowfield cache: " << cachePath << "\n";
+    out = FlowfieldCacheEntry();
+    return false;
+  }
+
+  return true;
+}
+
+bool StoreFlowfieldCache(
+    uint64_t objHash,
+    const FlowfieldSettings& settings,
+    FlowfieldCacheLayout layout,
+    const std::vector<float>& verts,
+    const std::vector<unsigned int>& indices,
+    const std::vector<FlowfieldLod>& lods,
+    const std::string& cacheDir
+) {
+  return StoreFlowfieldCache(
+      objHash,
+      settings,
+      layout,
+      verts.data(),
+      verts.size(),
+      indices.data(),
+      indices.size(),
+      lods.data(),
+      lods.size(),
+      cacheDir
+  );
+}
+
+bool StoreFlowfieldCache(
+    uint64_t objHash,
+    const FlowfieldSettings& settings,
+    FlowfieldCacheLayout layout,
+    const float* verts,
+    size_t vertFloatCount,
+    const unsigned int* indices,
+    size_t indexCount,
+    const FlowfieldLod* lods,
+    size_t lodCount,
+    const std::string& cacheDir
+) {
+  namespace fs = std::filesystem;
+
+  if (vertFloatCount == 0 || indexCount == 0) return false;
+
+  std::error_code ec;
+  fs::create_directories(cacheDir, ec);
+  if (ec) {
+    std::cerr << "Failed to create flowfield cache directory: " << cacheDir << "\n";
+    return false;
+  }
+
+  CacheHeader h{};
+  std::memcpy(h.magic, cacheMagic, sizeof(cacheMagic));
+  h.version = cacheVersion;
+  h.headerSize = sizeof(CacheHeader);
+  h.objHash = objHash;
+  h.settingsHash = hashSettings(settings, layout);
+  h.vertFloatCount = vertFloatCount;
+  h.indexCount = indexCount;
+  h.vertOffset = alignUp(sizeof(CacheHeader));
+  h.indexOffset = alignUp(h.vertOffset + vertFloatCount * sizeof(float));
+  h.lodCount = lodCount;
+  h.lodOffset = alignUp(h.indexOffset + indexCount * sizeof(unsigned int));
+  h.payloadHash = hashPayload(verts, vertFloatCount, indices, indexCount, lods, lodCount);
+
+  const std::string cachePath = GetFlowfieldCachePath(objHash, settings, layout, cacheDir);
+  // Unique per process and thread, so concurrent stores of the same entry never write the same temporary file
+  char tmpSuffix[40];
+  const size_t threadId = std::hash<std::thread::id>()(std::this_thread::get_id());
+  std::snprintf(tmpSuffix, sizeof(tmpSuffix), ".%d-%zx.tmp", processId(), threadId);
+  const std::string tmpPath = cachePath + tmpSuffix;
+
+  {
+    std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!f) {
+      std::cerr << "Failed to write flowfield cache: " << tmpPath << "\n";
+      return false;
+    }
+
+    const char zeros[payloadAlign] = {};
+    f.write((const char*)&h, sizeof(h));
+    f.write(zeros, (std::streamsize)(h.vertOffset - sizeof(h)));
+    f.write((const char*)verts, (std::streamsize)(vertFloatCount * sizeof(float)));
+    f.write(zeros, (std::streamsize)(h.indexOffset - h.vertOffset - vertFloatCount * sizeof(float)));
+    f.write((const char*)indices, (std::streamsize)(indexCount * sizeof(unsigned int)));
+    f.write(zeros, (std::streamsize)(h.lodOffset - h.indexOffset - indexCount * sizeof(unsigned int)));
+    f.write((const char*)lods, (std::streamsize)(lodCount * sizeof(FlowfieldLod)));
+
+    if (!f) {
+      std::cerr << "Failed to write flowfield cache: " << tmpPath << "\n";
+      f.close();
+      fs::remove(tmpPath, ec);
+      return false;
+    }
+  }
+
+  // Replace atomically so readers never observe a partially written entry
+  fs::rename(tmpPath, cachePath, ec);
+  if (ec) {
+    std::cerr << "Failed to write flowfield cache: " << cachePath << "\n";
+    fs::remove(tmpPath, ec);
+    return false;
+  }
+
+  return true;
+}
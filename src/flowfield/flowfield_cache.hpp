@@ -0,0 +1,75 @@
+#pragma once
+
+#include "flowfield.hpp"
+#include "mapped_file.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Baked flowfield meshes are cached on disk, keyed by a hash of the OBJ contents (HashFileContents) and the
+// settings that affect the result. Copies of a model share one entry, wherever they live and whichever machine
+// baked it, and edited models get a new entry.
+//
+// Entries from BakeFlowfieldStreaming are kept apart from in-memory bakes since their layout differs (triangles
+// grouped by chunk, border vertices duplicated). Their key ignores lodLevels, optimizeDrawOrder and
+// spatialReorder, which the streaming bake does not apply, so one streamed entry serves every value of them.
+
+enum class FlowfieldCacheLayout { InMemory, Streamed };
+
+constexpr const char* defaultFlowfieldCacheDir = "cache/flowfield";
+
+// Mapped cache entry. The buffers point into the mapping and stay valid as long as the entry lives.
+struct FlowfieldCacheEntry {
+  MappedFile file;
+  const float* verts = nullptr;
+  size_t vertFloatCount = 0;
+  const unsigned int* indices = nullptr;
+  size_t indexCount = 0;
+  const FlowfieldLod* lods = nullptr; // none when the entry was stored without levels of detail
+  size_t lodCount = 0;
+
+  explicit operator bool() const { return indices != nullptr; }
+};
+
+uint64_t HashFileContents(const std::string& path, bool* ok = nullptr);
+
+std::string GetFlowfieldCachePath(
+    uint64_t objHash,
+    const FlowfieldSettings& settings,
+    FlowfieldCacheLayout layout,
+    const std::string& cacheDir = defaultFlowfieldCacheDir
+);
+
+// Maps the cache entry for an OBJ whose contents hash to objHash. Fails if there is no entry or if it is corrupt.
+bool LoadFlowfieldCache(
+    uint64_t objHash,
+    const FlowfieldSettings& settings,
+    FlowfieldCacheLayout layout,
+    FlowfieldCacheEntry& out,
+    const std::string& cacheDir = defaultFlowfieldCacheDir
+);
+
+bool StoreFlowfieldCache(
+    uint64_t objHash,
+    const FlowfieldSettings& settings,
+    FlowfieldCacheLayout layout,
+    const std::vector<float>& verts,
+    const std::vector<unsigned int>& indices,
+    const std::vector<FlowfieldLod>& lods = {},
+    const std::string& cacheDir = defaultFlowfieldCacheDir
+);
+
+// Same for buffers that are not held in vectors, such as the mapped output of BakeFlowfieldStreaming
+bool StoreFlowfieldCache(
+    uint64_t objHash,
+    const FlowfieldSettings& settings,
+    FlowfieldCacheLayout layout,
+    const float* verts,
+    size_t vertFloatCount,
+    const unsigned int* indices,
+    size_t indexCount,
+    const FlowfieldLod* lods = nullptr,
+    size_t lodCount = 0,
+    const std::string& cacheDir = defaultFlowfieldCacheDir
+);
@@ -1,11 +1,17 @@
 // code generated by AI
 #include "flowfield_detail.hpp"
 
+#include "obj_parser.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include "tri_geometry.hpp"
+
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 #include <iostream>
-#include <queue>
+#include <utility>
 
 namespace flowfield::detail {
 
@@ -47,35 +53,13 @@ namespace flowfield::detail {
     return (size_t)x;
   }
 
-  std::size_t SplitKeyHash::operator()(const SplitKey& k) const noexcept {
-    uint64_t a = (uint32_t)k.v;
-    uint64_t b = (uint32_t)(k.vt + 1);
-    uint64_t c = (uint32_t)k.sg;
-    uint64_t x = (a * 1315423911ULL) ^ (b * 2654435761ULL) ^ (c * 97531ULL);
-    x ^= (x >> 33);
-    x *= 0xff51afd7ed558ccdULL;
-    x ^= (x >> 33);
-    x *= 0xc4ceb9fe1a85ec53ULL;
-    x ^= (x >> 33);
-    return (size_t)x;
-  }
-
-  std::size_t PairHash::operator()(const std::pair<int, int>& p) const noexcept {
-    return std::hash<int>()(p.first) ^ (std::hash<int>()(p.second) << 1);
-  }
-
-  bool loadObjAsPolys(const std::string& objPath, ObjPolys& out) {
-    tinyobj::ObjReaderConfig cfg;
-    cfg.triangulate = false;
-
-    tinyobj::ObjReader reader;
-    if (!reader.ParseFromFile(objPath, cfg)) {
-      std::cerr << "Failed to read OBJ: " << objPath << "\n";
-      return false;
-    }
+  bool loadObjAsPolys(const std::string& objPath, ObjPolys& out, int threads) {
+    TRACE_ZONE("loadObjAsPolys");
+    out.attrib = tinyobj::attrib_t();
+    out.polys = Csr<tinyobj::index_t>();
 
-    out.attrib = reader.GetAttrib();
-    const auto& shapes = reader.GetShapes();
+    auto& a = out.attrib;
+    if (!parseObjFile(objPath, a.vertices, a.texcoords, out.polys.offset, out.polys.items, threads)) return false;
 
     out.nV_in = (int)(out.attrib.vertices.size() / 3);
     out.nVT_in = (int)(out.attrib.texcoords.size() / 2);
@@ -85,26 +69,99 @@ namespace flowfield::detail {
       return false;
     }
 
-    out.polys.clear();
-    out.polys.reserve(shapes.size() * 16);
+    return true;
+  }
+
+  uint64_t spreadBits3(uint64_t x) {
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffULL;
+    x = (x | x << 16) & 0x1f0000ff0000ffULL;
+    x = (x | x << 8) & 0x100f00f00f00f00fULL;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2) & 0x1249249249249249ULL;
+    return x;
+  }
+
+  void reorderPolysMorton(ObjPolys& m, int threads) {
+    TRACE_ZONE("reorderPolysMorton");
+    auto& verts = m.attrib.vertices;
+    auto& texcoords = m.attrib.texcoords;
+    const int nV = m.nV_in;
+    const int nF = m.polys.rows();
+    if (nV <= 0) return;
+
+    float lo[3], hi[3];
+    for (int c = 0; c < 3; ++c) lo[c] = hi[c] = verts[(size_t)c];
+    for (size_t i = 0; i < (size_t)nV * 3; i += 3) {
+      for (int c = 0; c < 3; ++c) {
+        lo[c] = std::min(lo[c], verts[i + c]);
+        hi[c] = std::max(hi[c], verts[i + c]);
+      }
+    }
+
+    // One scale for all axes keeps the curve's cells cubic
+    const float extent = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]});
+    const double scale = extent > 0.0f ? (double)((1 << 21) - 1) / extent : 0.0;
+    auto morton = [&](double x, double y, double z) {
+      const uint64_t qx = (uint64_t)std::clamp((x - lo[0]) * scale, 0.0, (double)((1 << 21) - 1));
+      const uint64_t qy = (uint64_t)std::clamp((y - lo[1]) * scale, 0.0, (double)((1 << 21) - 1));
+      const uint64_t qz = (uint64_t)std::clamp((z - lo[2]) * scale, 0.0, (double)((1 << 21) - 1));
+      return spreadBits3(qx) | spreadBits3(qy) << 1 | spreadBits3(qz) << 2;
+    };
 
-    for (const auto& sh : shapes) {
-      size_t index_offset = 0;
-      for (size_t f = 0; f < sh.mesh.num_face_vertices.size(); f++) {
-        int fv = sh.mesh.num_face_vertices[f];
-        if (fv < 3) {
-          index_offset += (size_t)fv;
-          continue;
+    // Faces, by the centroid of their corners in range
+    std::vector<std::pair<uint64_t, int>> keys((size_t)nF);
+    parallelFor((size_t)nF, threads, [&](size_t begin, size_t end, int) {
+      for (size_t f = begin; f < end; ++f) {
+        double sum[3] = {0.0, 0.0, 0.0};
+        int n = 0;
+        for (const tinyobj::index_t& idx : m.polys.row((int)f)) {
+          if (idx.vertex_index < 0 || idx.vertex_index >= nV) continue;
+          for (int c = 0; c < 3; ++c) sum[c] += verts[(size_t)idx.vertex_index * 3 + c];
+          n++;
         }
-        std::vector<tinyobj::index_t> poly;
-        poly.reserve((size_t)fv);
-        for (int k = 0; k < fv; k++) poly.push_back(sh.mesh.indices[index_offset + (size_t)k]);
-        out.polys.push_back(std::move(poly));
-        index_offset += (size_t)fv;
+        keys[f] = {n > 0 ? morton(sum[0] / n, sum[1] / n, sum[2] / n) : 0, (int)f};
       }
+    });
+    std::sort(keys.begin(), keys.end());
+
+    // Corners in the new face order, vertices and texcoords numbered as they are first used, so vertices
+    // follow the curve too and the split output vertices come out in the same order
+    Csr<tinyobj::index_t> polys;
+    polys.offset.reserve((size_t)nF + 1);
+    polys.items.reserve(m.polys.items.size());
+    std::vector<int> newVertex((size_t)nV, -1), newTexcoord((size_t)m.nVT_in, -1);
+    int nextVertex = 0, nextTexcoord = 0;
+
+    for (const auto& [code, f] : keys) {
+      for (tinyobj::index_t idx : m.polys.row(f)) {
+        if (idx.vertex_index >= 0 && idx.vertex_index < nV) {
+          int& v = newVertex[(size_t)idx.vertex_index];
+          if (v < 0) v = nextVertex++;
+          idx.vertex_index = v;
+        }
+        if (idx.texcoord_index >= 0 && idx.texcoord_index < m.nVT_in) {
+          int& vt = newTexcoord[(size_t)idx.texcoord_index];
+          if (vt < 0) vt = nextTexcoord++;
+          idx.texcoord_index = vt;
+        }
+        polys.items.push_back(idx);
+      }
+      polys.offset.push_back((int)polys.items.size());
     }
 
-    return true;
+    // Unreferenced entries keep their file order behind the used ones
+    auto permute = [](std::vector<tinyobj::real_t>& values, std::vector<int>& newIndex, int next, int width) {
+      std::vector<tinyobj::real_t> sorted(values.size());
+      for (size_t i = 0; i < newIndex.size(); ++i) {
+        if (newIndex[i] < 0) newIndex[i] = next++;
+        std::copy_n(values.begin() + (ptrdiff_t)(i * width), width, sorted.begin() + (ptrdiff_t)newIndex[i] * width);
+      }
+      values.swap(sorted);
+    };
+    permute(verts, newVertex, nextVertex, 3);
+    permute(texcoords, newTexcoord, nextTexcoord, 2);
+    m.polys = std::move(polys);
   }
 
   int getVT(const tinyobj::index_t& idx, int nVT_in) {
@@ -113,164 +170,299 @@ namespace flowfield::detail {
     return vt;
   }
 
-  using FaceVertexToVt = std::vector<std::pair<int, int>>; // (v -> vt), sorted by v
+  std::vector<Tri> triangulate(const ObjPolys& m) {
+    TRACE_ZONE("triangulate");
+    std::vector<Tri> tris;
+    tris.reserve(m.polys.items.size() - (size_t)m.polys.rows() * 2);
 
-  static inline int findVt(const FaceVertexToVt& face, int v) {
-    auto it = std::lower_bound(face.begin(), face.end(), v, [](const std::pair<int, int>& a, int value) {
-      return a.first < value;
-    });
-    assert(it != face.end() && it->first == v);
-    return it->second;
+    for (int p = 0; p < m.polys.rows(); ++p) {
+      const int first = m.polys.offset[(size_t)p];
+      const int fv = m.polys.rowSize(p);
+      const auto* poly = m.polys.items.data() + first;
+      for (int i = 1; i < fv - 1; ++i) {
+        Tri t;
+        t.c0 = {poly[0], p, first};
+        t.c1 = {poly[i], p, first + i};
+        t.c2 = {poly[i + 1], p, first + i + 1};
+        tris.push_back(t);
+      }
+    }
+    return tris;
   }
 
-  static std::vector<FaceVertexToVt> buildFaceVertexToVt(const ObjPolys& m) {
-    std::vector<FaceVertexToVt> map(m.polys.size());
+  MeshTopology buildTopology(const ObjPolys& m, const std::vector<Tri>& tris, std::pmr::memory_resource* scratch) {
+    TRACE_ZONE("buildTopology");
+    const int nT = (int)tris.size();
+    const size_t nH = (size_t)nT * 3;
 
-    for (size_t p = 0; p < m.polys.size(); ++p) {
-      const auto& poly = m.polys[p];
-      auto& out = map[p];
-      out.reserve(poly.size());
+    MeshTopology topo;
+    topo.edgeOf.resize(nH);
+    topo.ringNext.resize(nH);
+    topo.polyEdge.resize(nH);
 
-      for (const auto& idx : poly) {
-        out.emplace_back(idx.vertex_index, getVT(idx, m.nVT_in));
+    // Closed manifold meshes have about one edge per two half-edges
+    FlatHashMap<EdgeKey, int, EdgeKeyHash> edgeIds(emptyEdgeKey, nH / 2, scratch);
+    std::pmr::vector<int> ringLast(scratch);
+    topo.edgeHalf.reserve(nH / 2);
+    ringLast.reserve(nH / 2);
+
+    for (int ti = 0; ti < nT; ++ti) {
+      const Tri& t = tris[(size_t)ti];
+      const int v[3] = {t.v0(), t.v1(), t.v2()};
+
+      for (int i = 0; i < 3; ++i) {
+        const int h = 3 * ti + i;
+        const int a = v[i];
+        const int b = v[(i + 1) % 3];
+
+        auto [id, inserted] = edgeIds.tryEmplace(EdgeKey{std::min(a, b), std::max(a, b)}, topo.edges());
+        const int e = *id;
+        topo.edgeOf[(size_t)h] = e;
+
+        if (inserted) {
+          topo.edgeHalf.push_back(h);
+          ringLast.push_back(h);
+          topo.ringNext[(size_t)h] = h;
+        } else {
+          topo.ringNext[(size_t)ringLast[(size_t)e]] = h;
+          topo.ringNext[(size_t)h] = topo.edgeHalf[(size_t)e];
+          ringLast[(size_t)e] = h;
+        }
       }
 
-      std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+      // Fan triangle (0, i, i + 1): c1 -> c2 is always a polygon edge, c0 -> c1 only for the first
+      // triangle and c2 -> c0 only for the last one
+      const int fv = m.polys.rowSize(t.c0.poly);
+      topo.polyEdge[(size_t)ti * 3 + 0] = t.c1.corner == t.c0.corner + 1;
+      topo.polyEdge[(size_t)ti * 3 + 1] = 1;
+      topo.polyEdge[(size_t)ti * 3 + 2] = t.c2.corner == t.c0.corner + fv - 1;
+    }
+
+    auto& vt = topo.vertexTris;
+    vt.offset.assign((size_t)m.nV_in + 1, 0);
+    for (const Tri& t : tris) {
+      if (t.v0() >= 0) vt.offset[(size_t)t.v0() + 1]++;
+      if (t.v1() >= 0) vt.offset[(size_t)t.v1() + 1]++;
+      if (t.v2() >= 0) vt.offset[(size_t)t.v2() + 1]++;
+    }
+    for (int v = 0; v < m.nV_in; ++v) vt.offset[(size_t)v + 1] += vt.offset[(size_t)v];
 
-      for (size_t r = 1; r < out.size(); ++r) {
-        assert(out[r - 1].first != out[r].first);
-      }
+    vt.items.resize((size_t)vt.offset[(size_t)m.nV_in]);
+    std::pmr::vector<int> fill(vt.offset.begin(), vt.offset.end() - 1, scratch);
+    for (int ti = 0; ti < nT; ++ti) {
+      const Tri& t = tris[(size_t)ti];
+      if (t.v0() >= 0) vt.items[(size_t)fill[(size_t)t.v0()]++] = ti;
+      if (t.v1() >= 0) vt.items[(size_t)fill[(size_t)t.v1()]++] = ti;
+      if (t.v2() >= 0) vt.items[(size_t)fill[(size_t)t.v2()]++] = ti;
     }
 
-    return map;
+    return topo;
   }
 
-  std::vector<std::vector<int>> buildUvNeighbors(const ObjPolys& m) {
-    std::vector<std::vector<int>> polyNeighbors(m.polys.size());
+  // The first polygon half-edge on each ring belongs to the first face that has the edge. Fan triangles
+  // visit a polygon's edges in order, so ascending half-edges follow the faces' edge order.
+  static std::pmr::vector<int> firstPolyHalfEdges(
+      const MeshTopology& topo,
+      int threads,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()
+  ) {
+    std::pmr::vector<int> firstPolyHalf((size_t)topo.edges(), -1, scratch);
+    parallelFor((size_t)topo.edges(), threads, [&](size_t begin, size_t end, int) {
+      for (size_t e = begin; e < end; ++e) {
+        int h = topo.edgeHalf[e];
+        do {
+          if (topo.polyEdge[(size_t)h]) {
+            firstPolyHalf[e] = h;
+            break;
+          }
+          h = topo.ringNext[(size_t)h];
+        } while (h != topo.edgeHalf[e]);
+      }
+    });
+    return firstPolyHalf;
+  }
 
-    std::unordered_map<EdgeKey, int, EdgeKeyHash> edgeToFace;
-    edgeToFace.reserve(m.polys.size() * 4);
+  // The face across polygon half-edge h when it shares the edge's texcoords with the first face that has the
+  // edge, -1 otherwise or when h belongs to that first face
+  static int uvNeighborAcross(
+      const ObjPolys& m,
+      const std::vector<Tri>& tris,
+      const MeshTopology& topo,
+      const std::pmr::vector<int>& firstPolyHalf,
+      int h
+  ) {
+    const int f = firstPolyHalf[(size_t)topo.edgeOf[(size_t)h]];
+    if (f == h) return -1;
 
-    const auto faceVt = buildFaceVertexToVt(m);
+    auto cornerOf = [&](int he) -> const tinyobj::index_t& {
+      return tris[(size_t)MeshTopology::tri(he)].corner(he % 3).idx;
+    };
 
-    for (int p = 0; p < (int)m.polys.size(); ++p) {
-      const auto& poly = m.polys[(size_t)p];
-      const int fv = (int)poly.size();
+    const auto& hA = cornerOf(h);
+    const auto& hB = cornerOf(MeshTopology::next(h));
+    const auto& fA = cornerOf(f);
+    const auto& fB = cornerOf(MeshTopology::next(f));
+    const bool sameDir = fA.vertex_index == hA.vertex_index;
 
-      for (int i = 0; i < fv; ++i) {
-        const int vA = poly[(size_t)i].vertex_index;
-        const int vB = poly[(size_t)((i + 1) % fv)].vertex_index;
-        const EdgeKey ekey{std::min(vA, vB), std::max(vA, vB)};
+    const int a0 = getVT(hA, m.nVT_in);
+    const int a1 = getVT(hB, m.nVT_in);
+    const int b0 = getVT(sameDir ? fA : fB, m.nVT_in);
+    const int b1 = getVT(sameDir ? fB : fA, m.nVT_in);
 
-        auto it = edgeToFace.find(ekey);
-        if (it == edgeToFace.end()) {
-          edgeToFace.emplace(ekey, p);
-          continue;
-        }
+    if (a0 < 0 || a1 < 0 || b0 < 0 || b1 < 0) return -1;
+    if (a0 != b0 || a1 != b1) return -1;
+    return tris[(size_t)MeshTopology::tri(f)].c0.poly;
+  }
 
-        const int nb = it->second;
+  Csr<int> buildUvNeighbors(const ObjPolys& m, const std::vector<Tri>& tris, const MeshTopology& topo) {
+    TRACE_ZONE("buildUvNeighbors");
+    const int nF = m.polys.rows();
+    const int nH = topo.halfEdges();
+    const std::pmr::vector<int> firstPolyHalf = firstPolyHalfEdges(topo, 1);
 
-        const int a0 = findVt(faceVt[(size_t)p], vA);
-        const int a1 = findVt(faceVt[(size_t)p], vB);
-        const int b0 = findVt(faceVt[(size_t)nb], vA);
-        const int b1 = findVt(faceVt[(size_t)nb], vB);
+    // Neighbor pairs in discovery order, turned into rows below
+    std::vector<std::pair<int, int>> pairs;
+    pairs.reserve(m.polys.items.size());
 
-        if (a0 < 0 || a1 < 0 || b0 < 0 || b1 < 0) continue;
+    for (int h = 0; h < nH; ++h) {
+      if (!topo.polyEdge[(size_t)h]) continue;
+      const int nb = uvNeighborAcross(m, tris, topo, firstPolyHalf, h);
+      if (nb >= 0) pairs.emplace_back(tris[(size_t)MeshTopology::tri(h)].c0.poly, nb);
+    }
 
-        if (a0 == b0 && a1 == b1) {
-          polyNeighbors[(size_t)p].push_back(nb);
-          polyNeighbors[(size_t)nb].push_back(p);
-        }
-      }
+    Csr<int> polyNeighbors;
+    polyNeighbors.offset.assign((size_t)nF + 1, 0);
+    for (const auto& pr : pairs) {
+      polyNeighbors.offset[(size_t)pr.first + 1]++;
+      polyNeighbors.offset[(size_t)pr.second + 1]++;
+    }
+    for (int f = 0; f < nF; ++f) polyNeighbors.offset[(size_t)f + 1] += polyNeighbors.offset[(size_t)f];
+
+    polyNeighbors.items.resize((size_t)polyNeighbors.offset[(size_t)nF]);
+    std::vector<int> fill(polyNeighbors.offset.begin(), polyNeighbors.offset.end() - 1);
+    for (const auto& pr : pairs) {
+      polyNeighbors.items[(size_t)fill[(size_t)pr.first]++] = pr.second;
+      polyNeighbors.items[(size_t)fill[(size_t)pr.second]++] = pr.first;
     }
 
     return polyNeighbors;
   }
 
-  std::vector<int> computeFaceIslandsBfs(const std::vector<std::vector<int>>& neighbors) {
-    std::vector<int> polyIsland(neighbors.size(), -1);
-    int nextId = 0;
+  // Lock-free union-find: a root is linked below the smaller root with a CAS, so parents only ever decrease
+  // and every set ends up rooted at its smallest face. Finds halve the path as they go.
+  static int findRootConcurrent(std::pmr::vector<std::atomic<int>>& parent, int x) {
+    for (;;) {
+      int p = parent[(size_t)x].load(std::memory_order_relaxed);
+      if (p == x) return x;
+      const int gp = parent[(size_t)p].load(std::memory_order_relaxed);
+      if (gp != p) parent[(size_t)x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+      x = gp;
+    }
+  }
 
-    for (int start = 0; start < (int)neighbors.size(); ++start) {
-      if (polyIsland[(size_t)start] != -1) continue;
+  static void uniteConcurrent(std::pmr::vector<std::atomic<int>>& parent, int a, int b) {
+    for (;;) {
+      a = findRootConcurrent(parent, a);
+      b = findRootConcurrent(parent, b);
+      if (a == b) return;
+      if (a < b) std::swap(a, b);
+      int expected = a;
+      if (parent[(size_t)a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+    }
+  }
 
-      std::queue<int> q;
-      q.push(start);
-      polyIsland[(size_t)start] = nextId;
+  std::vector<int> computeFaceIslands(
+      const ObjPolys& m,
+      const std::vector<Tri>& tris,
+      const MeshTopology& topo,
+      int threads,
+      std::pmr::memory_resource* scratch
+  ) {
+    TRACE_ZONE("computeFaceIslands");
+    const size_t nF = (size_t)m.polys.rows();
+    const std::pmr::vector<int> firstPolyHalf = firstPolyHalfEdges(topo, threads, scratch);
 
-      while (!q.empty()) {
-        int f = q.front();
-        q.pop();
-        for (int nb : neighbors[(size_t)f]) {
-          if (polyIsland[(size_t)nb] == -1) {
-            polyIsland[(size_t)nb] = nextId;
-            q.push(nb);
-          }
-        }
+    std::pmr::vector<std::atomic<int>> parent(nF, scratch);
+    parallelFor(nF, threads, [&](size_t begin, size_t end, int) {
+      for (size_t f = begin; f < end; ++f) parent[f].store((int)f, std::memory_order_relaxed);
+    });
+    parallelFor((size_t)topo.halfEdges(), threads, [&](size_t begin, size_t end, int) {
+      for (size_t h = begin; h < end; ++h) {
+        if (!topo.polyEdge[h]) continue;
+        const int nb = uvNeighborAcross(m, tris, topo, firstPolyHalf, (int)h);
+        if (nb >= 0) uniteConcurrent(parent, tris[(size_t)MeshTopology::tri((int)h)].c0.poly, nb);
       }
-      nextId++;
-    }
+    });
+
+    // Every island is rooted at its smallest face, so numbering the roots in ascending order gives the ids
+    // of a breadth-first search started from each unvisited face in turn
+    std::vector<int> polyIsland(nF);
+    parallelFor(nF, threads, [&](size_t begin, size_t end, int) {
+      for (size_t f = begin; f < end; ++f) polyIsland[f] = findRootConcurrent(parent, (int)f);
+    });
+
+    const int blocks = parallelBlockCount(nF, threads);
+    std::vector<int> blockRoots((size_t)blocks + 1, 0);
+    parallelFor(nF, threads, [&](size_t begin, size_t end, int block) {
+      int roots = 0;
+      for (size_t f = begin; f < end; ++f) roots += polyIsland[f] == (int)f;
+      blockRoots[(size_t)block + 1] = roots;
+    });
+    for (int b = 0; b < blocks; ++b) blockRoots[(size_t)b + 1] += blockRoots[(size_t)b];
+
+    // Roots come before the rest of their island, the parent array is reused for the root ids
+    parallelFor(nF, threads, [&](size_t begin, size_t end, int block) {
+      int id = blockRoots[(size_t)block];
+      for (size_t f = begin; f < end; ++f) {
+        if (polyIsland[f] == (int)f) parent[f].store(id++, std::memory_order_relaxed);
+      }
+    });
+    parallelFor(nF, threads, [&](size_t begin, size_t end, int) {
+      for (size_t f = begin; f < end; ++f) {
+        polyIsland[f] = parent[(size_t)polyIsland[f]].load(std::memory_order_relaxed);
+      }
+    });
 
     return polyIsland;
   }
 
-  std::vector<UvIsland> scoreIslandsAxis(const ObjPolys& m, const std::vector<int>& polyIsland) {
+  std::vector<UvIsland> scoreIslandsAxis(
+      const ObjPolys& m,
+      const TriGeometry& geom,
+      const std::vector<int>& polyIsland,
+      int threads
+  ) {
+    TRACE_ZONE("scoreIslandsAxis");
     int islandCount = 0;
     for (int id : polyIsland) islandCount = std::max(islandCount, id + 1);
 
+    // Faces of each island in ascending order, counted first so every list is allocated once
+    std::vector<int> islandSize((size_t)islandCount, 0);
+    for (int id : polyIsland) {
+      if (id >= 0) islandSize[(size_t)id]++;
+    }
     std::vector<UvIsland> islands((size_t)islandCount);
+    for (int i = 0; i < islandCount; ++i) islands[(size_t)i].faceIds.reserve((size_t)islandSize[(size_t)i]);
     for (int f = 0; f < (int)polyIsland.size(); ++f) {
       int iid = polyIsland[(size_t)f];
       if (iid >= 0) islands[(size_t)iid].faceIds.push_back(f);
     }
 
-    const auto& attrib = m.attrib;
-
-    for (auto& isl : islands) {
+    parallelForEach(islands.size(), threads, [&](size_t islandIdx) {
+      UvIsland& isl = islands[islandIdx];
       Eigen::Vector3d sumU = Eigen::Vector3d::Zero(), sumV = Eigen::Vector3d::Zero();
       double sumUlen = 0.0, sumVlen = 0.0;
 
       for (int faceid : isl.faceIds) {
-        const auto& poly = m.polys[(size_t)faceid];
-        int fv = (int)poly.size();
-
-        // Fan triangulation for scoring
-        for (int i = 1; i < fv - 1; ++i) {
-          int v[3], vt[3];
-          v[0] = poly[0].vertex_index;
-          vt[0] = getVT(poly[0], m.nVT_in);
-          v[1] = poly[(size_t)i].vertex_index;
-          vt[1] = getVT(poly[(size_t)i], m.nVT_in);
-          v[2] = poly[(size_t)(i + 1)].vertex_index;
-          vt[2] = getVT(poly[(size_t)(i + 1)], m.nVT_in);
-
-          if (v[0] < 0 || v[1] < 0 || v[2] < 0 || vt[0] < 0 || vt[1] < 0 || vt[2] < 0) continue;
-          if (v[0] >= m.nV_in || v[1] >= m.nV_in || v[2] >= m.nV_in) continue;
-
-          Eigen::Vector3d p0 = toV3(attrib.vertices, v[0]);
-          Eigen::Vector3d p1 = toV3(attrib.vertices, v[1]);
-          Eigen::Vector3d p2 = toV3(attrib.vertices, v[2]);
+        // Fan triangles of the face, every earlier face contributed rowSize - 2 of them
+        const int firstTri = m.polys.offset[(size_t)faceid] - 2 * faceid;
+        const int lastTri = firstTri + m.polys.rowSize(faceid) - 2;
 
-          Eigen::Vector3d n = (p1 - p0).cross(p2 - p0);
-          if (n.norm() < 1e-8) continue;
-          n.normalize();
+        for (int ti = firstTri; ti < lastTri; ++ti) {
+          if (2.0 * geom.area[(size_t)ti] < 1e-8) continue;
 
-          Eigen::Vector2d w0 = toV2(attrib.texcoords, vt[0]);
-          Eigen::Vector2d w1 = toV2(attrib.texcoords, vt[1]);
-          Eigen::Vector2d w2 = toV2(attrib.texcoords, vt[2]);
-
-          Eigen::Vector3d e1 = p1 - p0, e2 = p2 - p0;
-          Eigen::Vector2d d1 = w1 - w0, d2 = w2 - w0;
-
-          double denom = d1.x() * d2.y() - d2.x() * d1.y();
-          if (std::abs(denom) < 1e-20) continue;
-
-          double r = 1.0 / denom;
-          Eigen::Vector3d dPdu = (e1 * d2.y() - e2 * d1.y()) * r;
-          Eigen::Vector3d dPdv = (e2 * d1.x() - e1 * d2.x()) * r;
-
-          dPdu = projectToTangent(dPdu, n);
-          dPdv = projectToTangent(dPdv, n);
+          const Eigen::Vector3d dPdu = geom.dPdu((size_t)ti);
+          const Eigen::Vector3d dPdv = geom.dPdv((size_t)ti);
 
           double ulen = dPdu.norm();
           double vlen = dPdv.norm();
@@ -289,408 +481,424 @@ namespace flowfield::detail {
       isl.avgU = (sumUlen > 1e-8) ? Eigen::Vector3d(sumU / sumUlen) : Eigen::Vector3d::Zero();
       isl.avgV = (sumVlen > 1e-8) ? Eigen::Vector3d(sumV / sumVlen) : Eigen::Vector3d::Zero();
       isl.chosenAxis = (sumUlen > sumVlen) ? 'U' : 'V';
-    }
+    });
 
     return islands;
   }
 
-  std::vector<Tri> triangulate(const ObjPolys& m) {
-    std::vector<Tri> tris;
-    tris.reserve(m.polys.size() * 2);
-
-    for (int p = 0; p < (int)m.polys.size(); ++p) {
-      const auto& poly = m.polys[(size_t)p];
-      int fv = (int)poly.size();
-      for (int i = 1; i < fv - 1; ++i) {
-        Tri t;
-        t.c0 = {poly[0], p, 0};
-        t.c1 = {poly[(size_t)i], p, i};
-        t.c2 = {poly[(size_t)(i + 1)], p, i + 1};
-        tris.push_back(t);
-      }
-    }
-    return tris;
-  }
-
-  void computeTriNormalsAndAreas(
-      const ObjPolys& m, const std::vector<Tri>& tris, std::vector<Eigen::Vector3d>& triN, std::vector<double>& triA
+  std::vector<uint8_t> computeCreaseEdges(
+      const MeshTopology& topo,
+      const TriGeometry& geom,
+      double creaseThresholdAngleDeg,
+      int threads
   ) {
-    const auto& attrib = m.attrib;
-    triN.resize(tris.size());
-    triA.resize(tris.size());
-
-    for (size_t ti = 0; ti < tris.size(); ++ti) {
-      const Tri& t = tris[ti];
-      if (t.v0() < 0 || t.v1() < 0 || t.v2() < 0 || t.v0() >= m.nV_in || t.v1() >= m.nV_in || t.v2() >= m.nV_in) {
-        triN[ti] = Eigen::Vector3d(0, 0, 0);
-        triA[ti] = 0.0;
-        continue;
-      }
+    TRACE_ZONE("computeCreaseEdges");
+    std::vector<uint8_t> creaseEdge;
+    if (creaseThresholdAngleDeg <= 0.0) return creaseEdge;
 
-      Eigen::Vector3d p0 = toV3(attrib.vertices, t.v0());
-      Eigen::Vector3d p1 = toV3(attrib.vertices, t.v1());
-      Eigen::Vector3d p2 = toV3(attrib.vertices, t.v2());
-
-      Eigen::Vector3d nraw = (p1 - p0).cross(p2 - p0);
-      double dblA = nraw.norm();
-      if (dblA < 1e-20) {
-        triN[ti] = Eigen::Vector3d(0, 0, 0);
-        triA[ti] = 0.0;
-        continue;
-      }
+    double thresh = deg2rad(creaseThresholdAngleDeg);
+    creaseEdge.assign((size_t)topo.edges(), 0);
 
-      triN[ti] = nraw / dblA;
-      triA[ti] = 0.5 * dblA;
-    }
-  }
+    parallelFor((size_t)topo.edges(), threads, [&](size_t begin, size_t end, int) {
+      for (size_t e = begin; e < end; ++e) {
+        const int h0 = topo.edgeHalf[e];
+        const int h1 = topo.ringNext[(size_t)h0];
+        if (h1 == h0) continue;
 
-  std::unordered_map<EdgeKey, std::pair<int, int>, EdgeKeyHash> buildEdgeToTris(const std::vector<Tri>& tris) {
-    std::unordered_map<EdgeKey, std::pair<int, int>, EdgeKeyHash> edgeToTris;
-    edgeToTris.reserve(tris.size() * 2);
+        const Eigen::Vector3d n0 = geom.normal((size_t)MeshTopology::tri(h0));
+        const Eigen::Vector3d n1 = geom.normal((size_t)MeshTopology::tri(h1));
+        if (n0.norm() < 1e-12 || n1.norm() < 1e-12) continue;
 
-    auto add = [&](int ti, int a, int b) {
-      EdgeKey ek{std::min(a, b), std::max(a, b)};
-      auto it = edgeToTris.find(ek);
-      if (it == edgeToTris.end()) {
-        edgeToTris.emplace(ek, std::make_pair(ti, -1));
-        return;
+        double ang = std::acos(clampd(n0.dot(n1), -1.0, 1.0));
+        if (ang > thresh) creaseEdge[e] = 1;
       }
-      if (it->second.second == -1) it->second.second = ti;
-    };
-
-    for (int ti = 0; ti < (int)tris.size(); ++ti) {
-      const Tri& t = tris[(size_t)ti];
-      add(ti, t.v0(), t.v1());
-      add(ti, t.v1(), t.v2());
-      add(ti, t.v2(), t.v0());
-    }
+    });
 
-    return edgeToTris;
+    return creaseEdge;
   }
 
-  std::unordered_set<EdgeKey, EdgeKeyHash> computeCreaseEdges(
-      const std::unordered_map<EdgeKey, std::pair<int, int>, EdgeKeyHash>& edgeToTris,
-      const std::vector<Eigen::Vector3d>& triN,
-      double creaseThresholdAngleDeg
-  ) {
-    std::unordered_set<EdgeKey, EdgeKeyHash> creaseEdges;
-    if (creaseThresholdAngleDeg <= 0.0) return creaseEdges;
-
-    creaseEdges.reserve(edgeToTris.size() / 2);
-
-    double thresh = deg2rad(creaseThresholdAngleDeg);
-
-    for (const auto& kv : edgeToTris) {
-      const EdgeKey& e = kv.first;
-      int t0 = kv.second.first;
-      int t1 = kv.second.second;
-      if (t0 < 0 || t1 < 0) continue;
-
-      const Eigen::Vector3d& n0 = triN[(size_t)t0];
-      const Eigen::Vector3d& n1 = triN[(size_t)t1];
-      if (n0.norm() < 1e-12 || n1.norm() < 1e-12) continue;
-
-      double ang = std::acos(clampd(n0.dot(n1), -1.0, 1.0));
-      if (ang > thresh) creaseEdges.insert(e);
+  static int findRoot(std::vector<int>& parent, int x) {
+    while (parent[(size_t)x] != x) {
+      parent[(size_t)x] = parent[(size_t)parent[(size_t)x]];
+      x = parent[(size_t)x];
     }
+    return x;
+  }
 
-    return creaseEdges;
+  static void unite(std::vector<int>& parent, int a, int b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a == b) return;
+    if (a < b) parent[(size_t)b] = a;
+    else parent[(size_t)a] = b;
   }
 
-  void SmoothingHandler::compute(
-      int nV_in, const std::vector<Tri>& tris, const std::unordered_set<EdgeKey, EdgeKeyHash>& creaseEdges
+  std::vector<int> computeCornerSmoothingGroups(
+      const ObjPolys& m,
+      const std::vector<Tri>& tris,
+      const MeshTopology& topo,
+      const std::vector<uint8_t>& creaseEdge
   ) {
-    vTriToSG.resize((size_t)nV_in);
+    TRACE_ZONE("computeCornerSmoothingGroups");
+    const int nH = topo.halfEdges();
+
+    // Union-find over triangle corners (h = 3 * tri + i is also corner i of tri). Corners at the same
+    // vertex join when their triangles share a non-crease edge, i.e. sit on the same edge ring.
+    std::vector<int> parent((size_t)nH);
+    for (int h = 0; h < nH; ++h) parent[(size_t)h] = h;
 
-    std::vector<std::vector<int>> incident((size_t)nV_in);
     for (int ti = 0; ti < (int)tris.size(); ++ti) {
       const Tri& t = tris[(size_t)ti];
-      if (t.v0() >= 0) incident[(size_t)t.v0()].push_back(ti);
-      if (t.v1() >= 0) incident[(size_t)t.v1()].push_back(ti);
-      if (t.v2() >= 0) incident[(size_t)t.v2()].push_back(ti);
+      const int h = 3 * ti;
+      if (t.v0() == t.v1()) unite(parent, h + 0, h + 1);
+      if (t.v1() == t.v2()) unite(parent, h + 1, h + 2);
+      if (t.v2() == t.v0()) unite(parent, h + 2, h + 0);
     }
 
-    auto isNonCreaseEdgeFromV = [&](int v, int x) {
-      EdgeKey ek{std::min(v, x), std::max(v, x)};
-      return creaseEdges.find(ek) == creaseEdges.end();
-    };
+    auto startVertex = [&](int h) { return tris[(size_t)MeshTopology::tri(h)].corner(h % 3).idx.vertex_index; };
 
-    auto connected = [&](int v, int ta, int tb) -> bool {
-      const Tri& A = tris[(size_t)ta];
-      const Tri& B = tris[(size_t)tb];
-
-      int an1 = -1, an2 = -1, bn1 = -1, bn2 = -1;
-
-      if (A.v0() == v) {
-        an1 = A.v1();
-        an2 = A.v2();
-      } else if (A.v1() == v) {
-        an1 = A.v0();
-        an2 = A.v2();
-      } else if (A.v2() == v) {
-        an1 = A.v0();
-        an2 = A.v1();
-      } else {
-        return false;
-      }
+    for (int e = 0; e < topo.edges(); ++e) {
+      if (creaseEdge[(size_t)e]) continue;
 
-      if (B.v0() == v) {
-        bn1 = B.v1();
-        bn2 = B.v2();
-      } else if (B.v1() == v) {
-        bn1 = B.v0();
-        bn2 = B.v2();
-      } else if (B.v2() == v) {
-        bn1 = B.v0();
-        bn2 = B.v1();
-      } else {
-        return false;
+      const int h0 = topo.edgeHalf[(size_t)e];
+      const int a = startVertex(h0);
+      for (int h = topo.ringNext[(size_t)h0]; h != h0; h = topo.ringNext[(size_t)h]) {
+        const bool sameDir = startVertex(h) == a;
+        unite(parent, h0, sameDir ? h : MeshTopology::next(h));
+        unite(parent, MeshTopology::next(h0), sameDir ? MeshTopology::next(h) : h);
       }
+    }
 
-      if (an1 == bn1 || an1 == bn2) return isNonCreaseEdgeFromV(v, an1);
-      if (an2 == bn1 || an2 == bn2) return isNonCreaseEdgeFromV(v, an2);
-      return false;
-    };
-
-    for (int v = 0; v < nV_in; ++v) {
-      const auto& inc = incident[(size_t)v];
-      if (inc.empty()) continue;
-
-      auto& triToSg = vTriToSG[(size_t)v];
-      triToSg.reserve(inc.size());
-
+    // Number the groups around each vertex in order of their lowest incident triangle
+    std::vector<int> rootSG((size_t)nH, -1);
+    for (int v = 0; v < m.nV_in; ++v) {
       int nextSg = 0;
-
-      for (int tStart : inc) {
-        if (triToSg.count(tStart)) continue;
-
-        int sg = nextSg++;
-        std::queue<int> q;
-        q.push(tStart);
-        triToSg[tStart] = sg;
-
-        while (!q.empty()) {
-          int ta = q.front();
-          q.pop();
-          for (int tb : inc) {
-            if (triToSg.count(tb)) continue;
-            if (connected(v, ta, tb)) {
-              triToSg[tb] = sg;
-              q.push(tb);
-            }
-          }
-        }
+      for (int ti : topo.vertexTris.row(v)) {
+        const Tri& t = tris[(size_t)ti];
+        const int i = t.v0() == v ? 0 : (t.v1() == v ? 1 : 2);
+        int& sg = rootSG[(size_t)findRoot(parent, 3 * ti + i)];
+        if (sg < 0) sg = nextSg++;
       }
     }
-  }
 
-  int SmoothingHandler::getSG(int v, int triIndex) const {
-    if (v < 0 || v >= (int)vTriToSG.size()) return 0;
-    const auto& m = vTriToSG[(size_t)v];
-    auto it = m.find(triIndex);
-    if (it == m.end()) return 0;
-    return it->second;
+    // Polygon corners shared by several fan triangles take the group of the last one
+    std::vector<int> cornerSG(m.polys.items.size(), 0);
+    for (int h = 0; h < nH; ++h) {
+      const TriCorner& c = tris[(size_t)MeshTopology::tri(h)].corner(h % 3);
+      cornerSG[(size_t)c.corner] = rootSG[(size_t)findRoot(parent, h)];
+    }
+
+    return cornerSG;
   }
 
   SplitMesh buildSplitMesh(
       const ObjPolys& m,
       const std::vector<Tri>& tris,
-      const std::unordered_set<EdgeKey, EdgeKeyHash>& creaseEdges,
-      double creaseThresholdAngleDeg
+      const MeshTopology& topo,
+      const std::vector<uint8_t>& creaseEdge,
+      double creaseThresholdAngleDeg,
+      int threads,
+      std::pmr::memory_resource* scratch
   ) {
+    TRACE_ZONE("buildSplitMesh");
     const auto& attrib = m.attrib;
 
-    SmoothingHandler sh;
     const bool splitByCrease = (creaseThresholdAngleDeg > 0.0);
-    if (splitByCrease) sh.compute(m.nV_in, tris, creaseEdges);
-
-    std::unordered_map<std::pair<int, int>, int, PairHash> cornerToSG;
-    if (splitByCrease) {
-      cornerToSG.reserve(tris.size() * 2);
-      for (size_t ti = 0; ti < tris.size(); ++ti) {
-        const Tri& t = tris[ti];
-        cornerToSG[{t.c0.poly, t.c0.corner}] = sh.getSG(t.v0(), (int)ti);
-        cornerToSG[{t.c1.poly, t.c1.corner}] = sh.getSG(t.v1(), (int)ti);
-        cornerToSG[{t.c2.poly, t.c2.corner}] = sh.getSG(t.v2(), (int)ti);
+    std::vector<int> cornerSG;
+    if (splitByCrease) cornerSG = computeCornerSmoothingGroups(m, tris, topo, creaseEdge);
+
+    const size_t nCorners = m.polys.items.size();
+    const size_t nV = (size_t)m.nV_in;
+    auto cornerVertex = [&](size_t c) { return (size_t)m.polys.items[c].vertex_index; };
+
+    // Output vertices are the distinct (v, vt, sg) keys, numbered in order of their first corner as a
+    // sequential pass over the corners would. Corners are bucketed by v with a counting sort, the buckets
+    // (a vertex's few corners) are sorted by (vt, sg, corner), and a prefix sum over the first corners
+    // numbers the keys. Placement within a bucket is racy but the sort makes the result independent of it.
+    std::pmr::vector<int> bucket(nV + 1, 0, scratch);
+    std::pmr::vector<int> order(nCorners, scratch);
+    {
+      std::pmr::vector<std::atomic<int>> cursor(nV, scratch);
+      parallelFor(nCorners, threads, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; ++c) cursor[cornerVertex(c)].fetch_add(1, std::memory_order_relaxed);
+      });
+      for (size_t v = 0; v < nV; ++v) {
+        bucket[v + 1] = bucket[v] + cursor[v].load(std::memory_order_relaxed);
+        cursor[v].store(bucket[v], std::memory_order_relaxed);
       }
+      parallelFor(nCorners, threads, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; ++c) {
+          order[(size_t)cursor[cornerVertex(c)].fetch_add(1, std::memory_order_relaxed)] = (int)c;
+        }
+      });
     }
 
-    std::unordered_map<SplitKey, int, SplitKeyHash> splitMap;
-    splitMap.reserve(m.polys.size() * 3);
-
-    std::vector<Eigen::Vector3d> outPos;
-    outPos.reserve(m.polys.size() * 3);
-
-    std::vector<std::vector<int>> outFaces(m.polys.size());
-    std::vector<std::vector<int>> polyOutCorner(m.polys.size());
-
-    auto getOrCreateOut = [&](int vin, int vt, int sg) {
-      SplitKey key{vin, vt, sg};
-      auto it = splitMap.find(key);
-      if (it != splitMap.end()) return it->second;
-      int idx = (int)outPos.size();
-      outPos.push_back(toV3(attrib.vertices, vin));
-      splitMap.emplace(key, idx);
-      return idx;
+    auto cornerKey = [&](int c) {
+      return std::make_pair(getVT(m.polys.items[(size_t)c], m.nVT_in), splitByCrease ? cornerSG[(size_t)c] : 0);
     };
 
-    for (int p = 0; p < (int)m.polys.size(); ++p) {
-      const auto& poly = m.polys[(size_t)p];
-      int fv = (int)poly.size();
-      outFaces[(size_t)p].resize((size_t)fv);
-      polyOutCorner[(size_t)p].resize((size_t)fv);
-
-      for (int k = 0; k < fv; ++k) {
-        const tinyobj::index_t& idx = poly[(size_t)k];
-        int vin = idx.vertex_index;
-        int vt = getVT(idx, m.nVT_in);
-        int sg = 0;
-        if (splitByCrease) {
-          auto it = cornerToSG.find({p, k});
-          sg = (it != cornerToSG.end()) ? it->second : 0;
+    // groupFirst: the first corner with the same key
+    std::pmr::vector<int> groupFirst(nCorners, scratch);
+    parallelFor(nV, threads, [&](size_t begin, size_t end, int) {
+      for (size_t v = begin; v < end; ++v) {
+        int* first = order.data() + bucket[v];
+        int* last = order.data() + bucket[v + 1];
+        std::sort(first, last, [&](int a, int b) {
+          const auto ka = cornerKey(a), kb = cornerKey(b);
+          return ka != kb ? ka < kb : a < b;
+        });
+
+        for (int* it = first; it != last; ++it) {
+          const bool startsGroup = it == first || cornerKey(*it) != cornerKey(it[-1]);
+          groupFirst[(size_t)*it] = startsGroup ? *it : groupFirst[(size_t)it[-1]];
         }
-        int idxOut = getOrCreateOut(vin, vt, sg);
-        outFaces[(size_t)p][(size_t)k] = idxOut;
-        polyOutCorner[(size_t)p][(size_t)k] = idxOut;
       }
-    }
-
-    return SplitMesh{std::move(outPos), std::move(outFaces), std::move(polyOutCorner)};
-  }
-
-  std::vector<std::vector<int>> buildAdjacencyVec(const std::vector<std::vector<int>>& outFaces, int nV_out) {
-    std::vector<std::vector<int>> adj((size_t)nV_out);
+    });
 
-    for (auto& v : adj) v.reserve(8); // estimate average valence
+    // Exclusive prefix sum of the first corners, per block and then across blocks
+    std::vector<int> cornerOut(nCorners);
+    const int blocks = parallelBlockCount(nCorners, threads);
+    std::vector<int> blockFirsts((size_t)blocks + 1, 0);
+    parallelFor(nCorners, threads, [&](size_t begin, size_t end, int block) {
+      int firsts = 0;
+      for (size_t c = begin; c < end; ++c) firsts += groupFirst[c] == (int)c;
+      blockFirsts[(size_t)block + 1] = firsts;
+    });
+    for (int b = 0; b < blocks; ++b) blockFirsts[(size_t)b + 1] += blockFirsts[(size_t)b];
+
+    std::vector<Eigen::Vector3d> outPos((size_t)blockFirsts[(size_t)blocks]);
+    parallelFor(nCorners, threads, [&](size_t begin, size_t end, int block) {
+      int id = blockFirsts[(size_t)block];
+      for (size_t c = begin; c < end; ++c) {
+        if (groupFirst[c] != (int)c) continue;
+        cornerOut[c] = id;
+        outPos[(size_t)id++] = toV3(attrib.vertices, (int)cornerVertex(c));
+      }
+    });
+    // First corners come before the rest of their group, and their ids are final after the pass above
+    parallelFor(nCorners, threads, [&](size_t begin, size_t end, int) {
+      for (size_t c = begin; c < end; ++c) {
+        if (groupFirst[c] != (int)c) cornerOut[c] = cornerOut[(size_t)groupFirst[c]];
+      }
+    });
 
-    std::vector<int> stamp((size_t)nV_out, -1);
-    int curStamp = 0;
+    return SplitMesh{std::move(outPos), std::move(cornerOut)};
+  }
 
-    auto addUnique = [&](int a, int b) {
-      if (a == b) return;
-      if (stamp[(size_t)b] != curStamp) {
-        stamp[(size_t)b] = curStamp;
-        adj[(size_t)a].push_back(b);
+  Csr<int> buildAdjacencyVec(
+      const std::vector<Tri>& tris,
+      const MeshTopology& topo,
+      const std::vector<int>& cornerOut,
+      int nV_out,
+      std::pmr::memory_resource* scratch
+  ) {
+    TRACE_ZONE("buildAdjacencyVec");
+    Csr<int> adj;
+    adj.offset.assign((size_t)nV_out + 1, 0);
+
+    // Both directions of every polygon half-edge. Ascending half-edges follow face order.
+    auto forEachEdge = [&](auto&& fn) {
+      for (int h = 0; h < topo.halfEdges(); ++h) {
+        if (!topo.polyEdge[(size_t)h]) continue;
+        const Tri& t = tris[(size_t)MeshTopology::tri(h)];
+        const int a = cornerOut[(size_t)t.corner(h % 3).corner];
+        const int b = cornerOut[(size_t)t.corner(MeshTopology::next(h) % 3).corner];
+        if (a == b) continue;
+        fn(a, b);
+        fn(b, a);
       }
     };
 
-    for (const auto& face : outFaces) {
-      int fv = (int)face.size();
-      for (int i = 0; i < fv; ++i) {
-        int a = face[(size_t)i];
-        int b = face[(size_t)((i + 1) % fv)];
+    forEachEdge([&](int a, int) { adj.offset[(size_t)a + 1]++; });
+    for (int v = 0; v < nV_out; ++v) adj.offset[(size_t)v + 1] += adj.offset[(size_t)v];
 
-        curStamp++;
-        addUnique(a, b);
-        curStamp++;
-        addUnique(b, a);
-      }
-    }
+    adj.items.resize((size_t)adj.offset[(size_t)nV_out]);
+    std::pmr::vector<int> fill(adj.offset.begin(), adj.offset.end() - 1, scratch);
+    forEachEdge([&](int a, int b) { adj.items[(size_t)fill[(size_t)a]++] = b; });
 
     return adj;
   }
 
-  static inline Eigen::Vector2d getUV(const tinyobj::attrib_t& attrib, int vt, int nVT_in) {
-    if (vt < 0 || vt >= nVT_in) return Eigen::Vector2d(0, 0);
-    return toV2(attrib.texcoords, vt);
-  }
-
-  static inline int outIndexForTriCorner(const std::vector<std::vector<int>>& polyOutCorner, const Tri& t, int corner) {
+  static inline int outIndexForTriCorner(const std::vector<int>& cornerOut, const Tri& t, int corner) {
     const TriCorner* c = (corner == 0) ? &t.c0 : (corner == 1 ? &t.c1 : &t.c2);
-    int p = c->poly;
     int k = c->corner;
-    if (p < 0 || p >= (int)polyOutCorner.size()) return -1;
-    if (k < 0 || k >= (int)polyOutCorner[(size_t)p].size()) return -1;
-    return polyOutCorner[(size_t)p][(size_t)k];
+    if (k < 0 || k >= (int)cornerOut.size()) return -1;
+    return cornerOut[(size_t)k];
   }
 
-  void accumulateNormalsAndTangents(
-      const ObjPolys& m,
+  // Axis policies of the accumulation kernel: which UV direction a triangle's tangent follows
+  struct AxisU {
+    static bool useU(const Tri&, const std::vector<int>&, const std::vector<UvIsland>&) { return true; }
+  };
+
+  struct AxisV {
+    static bool useU(const Tri&, const std::vector<int>&, const std::vector<UvIsland>&) { return false; }
+  };
+
+  struct AxisPerIsland {
+    static bool useU(const Tri& t, const std::vector<int>& polyIsland, const std::vector<UvIsland>& islands) {
+      const int polyId = t.c0.poly;
+      const int iid = (polyId >= 0 && polyId < (int)polyIsland.size()) ? polyIsland[(size_t)polyId] : -1;
+      return (iid >= 0 && iid < (int)islands.size()) && islands[(size_t)iid].chosenAxis == 'U';
+    }
+  };
+
+  template<typename Scalar, typename Axis>
+  static void accumulateKernel(
       const std::vector<Tri>& tris,
       const std::vector<int>& polyIsland,
       const std::vector<UvIsland>& islands,
-      char axisSetting,
-      const std::vector<Eigen::Vector3d>& triN,
-      const std::vector<double>& triA,
-      const std::vector<std::vector<int>>& polyOutCorner,
+      const TriGeometry& geom,
+      const std::vector<int>& cornerOut,
       int nV_out,
       std::vector<Eigen::Vector3d>& vNormal,
       std::vector<Eigen::Vector3d>& vTangent,
-      std::vector<double>& vWeight
+      std::vector<double>& vWeight,
+      int threads,
+      std::pmr::memory_resource* scratch
   ) {
-    const auto& attrib = m.attrib;
+    using Vec3 = Eigen::Matrix<Scalar, 3, 1>;
+    const int nT = (int)tris.size();
+
+    // Per-triangle pass: output corners and tangent direction (zero if the triangle contributes no tangent)
+    std::pmr::vector<int> triOut((size_t)nT * 3, scratch);
+    std::pmr::vector<Vec3> triT((size_t)nT, scratch);
+
+    parallelFor((size_t)nT, threads, [&](size_t begin, size_t end, int) {
+      for (size_t ti = begin; ti < end; ++ti) {
+        const Tri& t = tris[ti];
+        int* ov = &triOut[ti * 3];
+        triT[ti] = Vec3(0, 0, 0);
+
+        ov[0] = ov[1] = ov[2] = -1;
+        if (geom.area[ti] <= 0.0f) continue;
+
+        const int o0 = outIndexForTriCorner(cornerOut, t, 0);
+        const int o1 = outIndexForTriCorner(cornerOut, t, 1);
+        const int o2 = outIndexForTriCorner(cornerOut, t, 2);
+        if (o0 < 0 || o1 < 0 || o2 < 0) continue;
+        ov[0] = o0;
+        ov[1] = o1;
+        ov[2] = o2;
+
+        // Already projected into the triangle plane, zero without usable UVs
+        const Vec3 d = Axis::useU(t, polyIsland, islands) ? Vec3(geom.ux[ti], geom.uy[ti], geom.uz[ti])
+                                                          : Vec3(geom.vx[ti], geom.vy[ti], geom.vz[ti]);
+        const Scalar len = d.norm();
+        if (len < Scalar(1e-12)) continue;
+        const Vec3 tdir = d / len;
+        if (tdir.squaredNorm() < Scalar(1e-24)) continue;
+
+        triT[ti] = tdir;
+      }
+    });
+
+    // Incident triangles per output vertex in ascending order, so the gather below
+    // visits contributions in the same order as a sequential scatter would
+    std::pmr::vector<int> incOffset((size_t)nV_out + 1, 0, scratch);
+    for (int ov : triOut) {
+      if (ov >= 0) incOffset[(size_t)ov + 1]++;
+    }
+    for (int v = 0; v < nV_out; ++v) incOffset[(size_t)v + 1] += incOffset[(size_t)v];
+
+    std::pmr::vector<int> incTri((size_t)incOffset[(size_t)nV_out], scratch);
+    {
+      std::pmr::vector<int> fill(incOffset.begin(), incOffset.end() - 1, scratch);
+      for (int ti = 0; ti < nT; ++ti) {
+        for (int k = 0; k < 3; ++k) {
+          const int ov = triOut[(size_t)ti * 3 + (size_t)k];
+          if (ov >= 0) incTri[(size_t)fill[(size_t)ov]++] = ti;
+        }
+      }
+    }
 
     vNormal.assign((size_t)nV_out, Eigen::Vector3d(0, 0, 0));
     vTangent.assign((size_t)nV_out, Eigen::Vector3d(0, 0, 0));
     vWeight.assign((size_t)nV_out, 0.0);
 
-    for (size_t ti = 0; ti < tris.size(); ++ti) {
-      const Tri& t = tris[ti];
-      const double area = triA[ti];
-      const Eigen::Vector3d& n = triN[ti];
-      if (area <= 0.0 || n.squaredNorm() < 1e-24) continue;
-
-      int ov0 = outIndexForTriCorner(polyOutCorner, t, 0);
-      int ov1 = outIndexForTriCorner(polyOutCorner, t, 1);
-      int ov2 = outIndexForTriCorner(polyOutCorner, t, 2);
-      if (ov0 < 0 || ov1 < 0 || ov2 < 0) continue;
-
-      vNormal[(size_t)ov0] += area * n;
-      vNormal[(size_t)ov1] += area * n;
-      vNormal[(size_t)ov2] += area * n;
-
-      const int vt0 = t.c0.idx.texcoord_index;
-      const int vt1 = t.c1.idx.texcoord_index;
-      const int vt2 = t.c2.idx.texcoord_index;
-      if (vt0 < 0 || vt1 < 0 || vt2 < 0 || vt0 >= m.nVT_in || vt1 >= m.nVT_in || vt2 >= m.nVT_in) continue;
-
-      const int v0 = t.v0(), v1 = t.v1(), v2 = t.v2();
-      if (v0 < 0 || v1 < 0 || v2 < 0) continue;
-      if (v0 >= m.nV_in || v1 >= m.nV_in || v2 >= m.nV_in) continue;
-
-      const Eigen::Vector3d p0 = toV3(attrib.vertices, v0);
-      const Eigen::Vector3d p1 = toV3(attrib.vertices, v1);
-      const Eigen::Vector3d p2 = toV3(attrib.vertices, v2);
-
-      const Eigen::Vector2d w0 = getUV(attrib, vt0, m.nVT_in);
-      const Eigen::Vector2d w1 = getUV(attrib, vt1, m.nVT_in);
-      const Eigen::Vector2d w2 = getUV(attrib, vt2, m.nVT_in);
-
-      const Eigen::Vector3d e1 = p1 - p0;
-      const Eigen::Vector3d e2 = p2 - p0;
-      const Eigen::Vector2d d1 = w1 - w0;
-      const Eigen::Vector2d d2 = w2 - w0;
-
-      const double denom = d1.x() * d2.y() - d2.x() * d1.y();
-      if (std::abs(denom) < 1e-20) continue;
-
-      const double r = 1.0 / denom;
-      const Eigen::Vector3d dPdu = (e1 * d2.y() - e2 * d1.y()) * r;
-      const Eigen::Vector3d dPdv = (e2 * d1.x() - e1 * d2.x()) * r;
-
-      char usedAxis = axisSetting;
-      if (axisSetting == 'A') {
-        const int polyId = t.c0.poly;
-        const int iid = (polyId >= 0 && polyId < (int)polyIsland.size()) ? polyIsland[(size_t)polyId] : -1;
-        usedAxis = (iid >= 0 && iid < (int)islands.size()) ? islands[(size_t)iid].chosenAxis : 'V';
+    parallelFor((size_t)nV_out, threads, [&](size_t begin, size_t end, int) {
+      for (size_t ov = begin; ov < end; ++ov) {
+        Vec3 nacc(0, 0, 0);
+        Vec3 acc(0, 0, 0);
+        Scalar w = 0;
+
+        for (int i = incOffset[ov]; i < incOffset[ov + 1]; ++i) {
+          const size_t ti = (size_t)incTri[(size_t)i];
+          const Scalar area = geom.area[ti];
+          nacc += area * Vec3(geom.nx[ti], geom.ny[ti], geom.nz[ti]);
+
+          const Vec3& tdir = triT[ti];
+          if (tdir.squaredNorm() < Scalar(1e-24)) continue;
+
+          // The flip depends on the running sum, the fixed order keeps it independent of the thread count
+          if (acc.squaredNorm() > Scalar(1e-24) && acc.dot(tdir) < Scalar(0))
+            acc -= area * tdir;
+          else
+            acc += area * tdir;
+          w += area;
+        }
+
+        vNormal[ov] = nacc.template cast<double>();
+        vTangent[ov] = acc.template cast<double>();
+        vWeight[ov] = (double)w;
       }
+    });
+  }
+
+  template<typename Scalar>
+  static void accumulateForAxis(
+      char axisSetting,
+      const std::vector<Tri>& tris,
+      const std::vector<int>& polyIsland,
+      const std::vector<UvIsland>& islands,
+      const TriGeometry& geom,
+      const std::vector<int>& cornerOut,
+      int nV_out,
+      std::vector<Eigen::Vector3d>& vNormal,
+      std::vector<Eigen::Vector3d>& vTangent,
+      std::vector<double>& vWeight,
+      int threads,
+      std::pmr::memory_resource* scratch
+  ) {
+    if (axisSetting == 'U') {
+      accumulateKernel<Scalar, AxisU>(
+          tris, polyIsland, islands, geom, cornerOut, nV_out, vNormal, vTangent, vWeight, threads, scratch
+      );
+    } else if (axisSetting == 'A') {
+      accumulateKernel<Scalar, AxisPerIsland>(
+          tris, polyIsland, islands, geom, cornerOut, nV_out, vNormal, vTangent, vWeight, threads, scratch
+      );
+    } else {
+      accumulateKernel<Scalar, AxisV>(
+          tris, polyIsland, islands, geom, cornerOut, nV_out, vNormal, vTangent, vWeight, threads, scratch
+      );
+    }
+  }
 
-      Eigen::Vector3d tdir = (usedAxis == 'U') ? dPdu : dPdv;
-      tdir = safeNormalize(projectToTangent(tdir, n));
-      if (tdir.squaredNorm() < 1e-24) continue;
-
-      const auto add = [&](int ov) {
-        Eigen::Vector3d& acc = vTangent[(size_t)ov];
-        if (acc.squaredNorm() > 1e-24 && acc.dot(tdir) < 0.0)
-          acc -= area * tdir;
-        else
-          acc += area * tdir;
-        vWeight[(size_t)ov] += area;
-      };
-
-      add(ov0);
-      add(ov1);
-      add(ov2);
+  void accumulateNormalsAndTangents(
+      const std::vector<Tri>& tris,
+      const std::vector<int>& polyIsland,
+      const std::vector<UvIsland>& islands,
+      char axisSetting,
+      const TriGeometry& geom,
+      const std::vector<int>& cornerOut,
+      int nV_out,
+      std::vector<Eigen::Vector3d>& vNormal,
+      std::vector<Eigen::Vector3d>& vTangent,
+      std::vector<double>& vWeight,
+      int threads,
+      bool singlePrecision,
+      std::pmr::memory_resource* scratch
+  ) {
+    TRACE_ZONE("accumulateNormalsAndTangents");
+    if (singlePrecision) {
+      accumulateForAxis<float>(
+          axisSetting, tris, polyIsland, islands, geom, cornerOut, nV_out, vNormal, vTangent, vWeight, threads, scratch
+      );
+    } else {
+      accumulateForAxis<double>(
+          axisSetting, tris, polyIsland, islands, geom, cornerOut, nV_out, vNormal, vTangent, vWeight, threads, scratch
+      );
     }
   }
 
@@ -698,8 +906,11 @@ namespace flowfield::detail {
       const std::vector<Eigen::Vector3d>& vNormal,
       const std::vector<Eigen::Vector3d>& vTangent,
       const std::vector<double>& vWeight,
-      const std::vector<std::vector<int>>& adj
+      const Csr<int>& adj,
+      int threads,
+      std::pmr::memory_resource* scratch
   ) {
+    TRACE_ZONE("buildFlowFromAccum");
     const int n = (int)vNormal.size();
     std::vector<Eigen::Vector3d> flow((size_t)n, Eigen::Vector3d(0, 0, 0));
 
@@ -709,45 +920,62 @@ namespace flowfield::detail {
       return nrm;
     };
 
-    for (int v = 0; v < n; ++v) {
-      const Eigen::Vector3d nrm = normalFor(v);
-      Eigen::Vector3d t = (vWeight[(size_t)v] > 0.0)
-          ? (vTangent[(size_t)v] / vWeight[(size_t)v])
-          : Eigen::Vector3d(0, 0, 0);
-      flow[(size_t)v] = safeNormalize(projectToTangent(t, nrm));
-    }
+    parallelFor((size_t)n, threads, [&](size_t begin, size_t end, int) {
+      for (int v = (int)begin; v < (int)end; ++v) {
+        const Eigen::Vector3d nrm = normalFor(v);
+        Eigen::Vector3d t = (vWeight[(size_t)v] > 0.0)
+            ? (vTangent[(size_t)v] / vWeight[(size_t)v])
+            : Eigen::Vector3d(0, 0, 0);
+        flow[(size_t)v] = safeNormalize(projectToTangent(t, nrm));
+      }
+    });
 
     auto isValid = [&](int v) { return flow[(size_t)v].squaredNorm() > 1e-12; };
 
-    std::vector<uint8_t> visited((size_t)n, 0);
-    std::vector<int> q;
-    q.reserve(512);
+    // Components are disjoint, so one visited/sign pair covers all of them and the per-component buffers
+    // below are reused. Every vertex and adjacency entry is touched a constant number of times.
+    std::pmr::vector<uint8_t> visited((size_t)n, 0, scratch);
+    std::pmr::vector<int8_t> sign((size_t)n, 0, scratch);
+    std::pmr::vector<int> level((size_t)n, -1, scratch); // BFS distance from the nearest valid vertex while filling
+    std::pmr::vector<int> comp(scratch), bfs(scratch), pending(scratch);
+    // Reserved for the largest component, so the arena never sees them grow
+    comp.reserve((size_t)n);
+    bfs.reserve((size_t)n);
+    pending.reserve((size_t)n);
+
+    // For components without any valid tangent, and for vertices whose closer neighbors all point along
+    // their normal
+    auto fallbackFor = [](const Eigen::Vector3d& nrm) {
+      Eigen::Vector3d ref(1, 0, 0);
+      if (std::abs(nrm.dot(ref)) > 0.99) ref = Eigen::Vector3d(0, 1, 0);
+      return safeNormalize(projectToTangent(ref, nrm));
+    };
 
     for (int start = 0; start < n; ++start) {
       if (visited[(size_t)start]) continue;
 
-      q.clear();
-      q.push_back(start);
+      // comp doubles as the BFS queue
+      comp.clear();
+      comp.push_back(start);
       visited[(size_t)start] = 1;
 
-      std::vector<int> comp;
-      comp.reserve(256);
-
-      for (size_t i = 0; i < q.size(); ++i) {
-        const int v = q[i];
-        comp.push_back(v);
-        for (int nb : adj[(size_t)v]) {
+      for (size_t i = 0; i < comp.size(); ++i) {
+        for (int nb : adj.row(comp[i])) {
           if (!visited[(size_t)nb]) {
             visited[(size_t)nb] = 1;
-            q.push_back(nb);
+            comp.push_back(nb);
           }
         }
       }
 
       int anchor = -1;
       double bestW = -1.0;
+      pending.clear();
       for (int v : comp) {
-        if (!isValid(v)) continue;
+        if (!isValid(v)) {
+          pending.push_back(v);
+          continue;
+        }
         const double w = vWeight[(size_t)v];
         if (w > bestW) {
           bestW = w;
@@ -756,69 +984,71 @@ namespace flowfield::detail {
       }
 
       if (anchor >= 0) {
-        std::vector<int8_t> sign((size_t)n, 0);
-
-        std::queue<int> bfs;
-        bfs.push(anchor);
+        bfs.clear();
+        bfs.push_back(anchor);
         sign[(size_t)anchor] = +1;
 
-        while (!bfs.empty()) {
-          const int v = bfs.front();
-          bfs.pop();
-
-          if (!isValid(v)) continue;
+        for (size_t head = 0; head < bfs.size(); ++head) {
+          const int v = bfs[head];
           const Eigen::Vector3d tv = (double)sign[(size_t)v] * flow[(size_t)v];
 
-          for (int nb : adj[(size_t)v]) {
+          for (int nb : adj.row(v)) {
             if (sign[(size_t)nb] != 0) continue;
             if (!isValid(nb)) continue;
 
             sign[(size_t)nb] = (tv.dot(flow[(size_t)nb]) >= 0.0) ? +1 : -1;
-            bfs.push(nb);
+            bfs.push_back(nb);
           }
         }
 
-        for (int v : comp) {
-          if (sign[(size_t)v] != 0) flow[(size_t)v] = (double)sign[(size_t)v] * flow[(size_t)v];
-        }
+        for (int v : bfs) flow[(size_t)v] = (double)sign[(size_t)v] * flow[(size_t)v];
+      }
+
+      if (pending.empty()) continue;
+
+      if (anchor < 0) {
+        for (int v : pending) flow[(size_t)v] = fallbackFor(normalFor(v));
+        continue;
+      }
+
+      // Multi-source BFS from all valid vertices. An invalid vertex is filled once, when it is reached, from
+      // the neighbors that are strictly closer to valid data, so the fill follows distance order.
+      bfs.clear();
+      for (int v : comp) {
+        if (!isValid(v)) continue;
+        level[(size_t)v] = 0;
+        bfs.push_back(v);
       }
 
-      constexpr int fillPasses = 6;
-      for (int pass = 0; pass < fillPasses; ++pass) {
-        int changed = 0;
-        for (int v : comp) {
-          if (isValid(v)) continue;
+      for (size_t head = 0; head < bfs.size(); ++head) {
+        const int v = bfs[head];
+        const int lv = level[(size_t)v];
 
+        if (lv > 0) {
           const Eigen::Vector3d nrm = normalFor(v);
+          auto closer = [&](int nb) { return level[(size_t)nb] >= 0 && level[(size_t)nb] < lv; };
 
           Eigen::Vector3d acc(0, 0, 0);
-          int cnt = 0;
-          for (int nb : adj[(size_t)v]) {
-            if (!isValid(nb)) continue;
-            acc += flow[(size_t)nb];
-            cnt++;
+          for (int nb : adj.row(v)) {
+            if (closer(nb)) acc += flow[(size_t)nb];
           }
+          Eigen::Vector3d t = safeNormalize(projectToTangent(acc, nrm));
 
-          if (cnt <= 0) continue;
-
-          const Eigen::Vector3d t = safeNormalize(projectToTangent(acc, nrm));
-          if (t.squaredNorm() < 1e-24) continue;
+          // Opposing neighbors cancel out, take the first one that survives projection instead
+          for (int nb : adj.row(v)) {
+            if (t.squaredNorm() >= 1e-24) break;
+            if (closer(nb)) t = safeNormalize(projectToTangent(flow[(size_t)nb], nrm));
+          }
+          if (t.squaredNorm() < 1e-24) t = fallbackFor(nrm);
 
           flow[(size_t)v] = t;
-          changed++;
         }
-        if (changed == 0) break;
-      }
-
-      for (int v : comp) {
-        if (isValid(v)) continue;
-
-        const Eigen::Vector3d nrm = normalFor(v);
 
-        Eigen::Vector3d ref(1, 0, 0);
-        if (std::abs(nrm.dot(ref)) > 0.99) ref = Eigen::Vector3d(0, 1, 0);
-
-        flow[(size_t)v] = safeNormalize(projectToTangent(ref, nrm));
+        for (int nb : adj.row(v)) {
+          if (level[(size_t)nb] >= 0) continue;
+          level[(size_t)nb] = lv + 1;
+          bfs.push_back(nb);
+        }
       }
     }
 
@@ -828,42 +1058,42 @@ namespace flowfield::detail {
   void packInterleavedVertices(
       const std::vector<Eigen::Vector3d>& outPos,
       const std::vector<Eigen::Vector3d>& outFlow,
-      std::vector<float>& outVert
+      std::vector<float>& outVert,
+      int threads
   ) {
+    TRACE_ZONE("packInterleavedVertices");
     const int nV_out = (int)outPos.size();
-    outVert.clear();
-    outVert.reserve((size_t)nV_out * 6);
-
-    for (int i = 0; i < nV_out; ++i) {
-      const auto& p = outPos[(size_t)i];
-      const auto& t = outFlow[(size_t)i];
-
-      outVert.push_back((float)p.x());
-      outVert.push_back((float)p.y());
-      outVert.push_back((float)p.z());
-      outVert.push_back((float)t.x());
-      outVert.push_back((float)t.y());
-      outVert.push_back((float)t.z());
-    }
+    outVert.resize((size_t)nV_out * 6);
+
+    parallelFor((size_t)nV_out, threads, [&](size_t begin, size_t end, int) {
+      for (size_t i = begin; i < end; ++i) {
+        const auto& p = outPos[i];
+        const auto& t = outFlow[i];
+        float* o = &outVert[i * 6];
+
+        o[0] = (float)p.x();
+        o[1] = (float)p.y();
+        o[2] = (float)p.z();
+        o[3] = (float)t.x();
+        o[4] = (float)t.y();
+        o[5] = (float)t.z();
+      }
+    });
   }
 
-  void packTriangleIndices(const std::vector<std::vector<int>>& polyOutCorner, std::vector<unsigned int>& outInd) {
+  void packTriangleIndices(const ObjPolys& m, const std::vector<int>& cornerOut, std::vector<unsigned int>& outInd) {
+    TRACE_ZONE("packTriangleIndices");
     outInd.clear();
+    outInd.reserve((m.polys.items.size() - (size_t)m.polys.rows() * 2) * 3);
 
-    size_t approx = 0;
-    for (const auto& f : polyOutCorner) {
-      if (f.size() >= 3) approx += (f.size() - 2) * 3;
-    }
-    outInd.reserve(approx);
-
-    for (int p = 0; p < (int)polyOutCorner.size(); ++p) {
-      const auto& face = polyOutCorner[(size_t)p];
-      int fv = (int)face.size();
+    for (int p = 0; p < m.polys.rows(); ++p) {
+      const int* face = cornerOut.data() + m.polys.offset[(size_t)p];
+      int fv = m.polys.rowSize(p);
       if (fv < 3) continue;
       for (int i = 1; i < fv - 1; ++i) {
         outInd.push_back((unsigned int)face[0]);
-        outInd.push_back((unsigned int)face[(size_t)i]);
-        outInd.push_back((unsigned int)face[(size_t)(i + 1)]);
+        outInd.push_back((unsigned int)face[i]);
+        outInd.push_back((unsigned int)face[i + 1]);
       }
     }
   }
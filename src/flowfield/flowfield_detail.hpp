@@ -3,12 +3,14 @@
 
 #define _USE_MATH_DEFINES
 
+#include "flat_hash.hpp"
+
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <tiny_obj_loader.h>
 
-#include <unordered_map>
-#include <unordered_set>
+#include <cstdint>
+#include <memory_resource>
 #include <vector>
 
 namespace flowfield::detail {
@@ -23,6 +25,26 @@ namespace flowfield::detail {
 
   double clampd(double x, double a, double b);
 
+  // Compressed rows: row r holds items[offset[r]] .. items[offset[r + 1] - 1].
+  template<typename T>
+  struct Csr {
+    struct Row {
+      const T* first;
+      const T* last;
+      const T* begin() const { return first; }
+      const T* end() const { return last; }
+      int size() const { return (int)(last - first); }
+      const T& operator[](int i) const { return first[i]; }
+    };
+
+    std::vector<int> offset{0};
+    std::vector<T> items;
+
+    int rows() const { return (int)offset.size() - 1; }
+    int rowSize(int r) const { return offset[(size_t)r + 1] - offset[(size_t)r]; }
+    Row row(int r) const { return Row{items.data() + offset[(size_t)r], items.data() + offset[(size_t)r + 1]}; }
+  };
+
   struct EdgeKey {
     int a, b;
     bool operator==(const EdgeKey& o) const noexcept { return a == o.a && b == o.b; }
@@ -32,18 +54,7 @@ namespace flowfield::detail {
     std::size_t operator()(const EdgeKey& k) const noexcept;
   };
 
-  struct SplitKey {
-    int v, vt, sg;
-    bool operator==(const SplitKey& o) const noexcept { return v == o.v && vt == o.vt && sg == o.sg; }
-  };
-
-  struct SplitKeyHash {
-    std::size_t operator()(const SplitKey& k) const noexcept;
-  };
-
-  struct PairHash {
-    std::size_t operator()(const std::pair<int, int>& p) const noexcept;
-  };
+  constexpr EdgeKey emptyEdgeKey{-1, -1};
 
   struct UvIsland {
     std::vector<int> faceIds;
@@ -55,7 +66,7 @@ namespace flowfield::detail {
   struct TriCorner {
     tinyobj::index_t idx;
     int poly = -1;
-    int corner = -1;
+    int corner = -1; // index into ObjPolys::polys.items
   };
 
   struct Tri {
@@ -63,89 +74,156 @@ namespace flowfield::detail {
     int v0() const { return c0.idx.vertex_index; }
     int v1() const { return c1.idx.vertex_index; }
     int v2() const { return c2.idx.vertex_index; }
-  };
-
-  struct SmoothingHandler {
-    std::vector<std::unordered_map<int, int>> vTriToSG;
 
-    void compute(int nV_in, const std::vector<Tri>& tris, const std::unordered_set<EdgeKey, EdgeKeyHash>& creaseEdges);
+    const TriCorner& corner(int i) const { return i == 0 ? c0 : (i == 1 ? c1 : c2); }
+  };
 
-    int getSG(int v, int triIndex) const;
+  // Connectivity of the triangulated mesh over input vertices, built once and shared by all stages.
+  // Half-edge h = 3 * tri + i runs from corner i to corner (i + 1) % 3 of tris[tri]. Half-edges on the
+  // same undirected edge form a cyclic ring in ascending order, so ringNext of an edge's first half-edge
+  // is its second triangle (or itself on a boundary). Non-manifold edges simply have longer rings.
+  struct MeshTopology {
+    std::vector<int> edgeOf;       // half-edge -> undirected edge id
+    std::vector<int> ringNext;     // half-edge -> next half-edge on the same edge
+    std::vector<uint8_t> polyEdge; // half-edge -> 1 if it is a polygon edge, 0 for fan diagonals
+    std::vector<int> edgeHalf;     // edge -> first half-edge
+    Csr<int> vertexTris;           // input vertex -> incident triangles, ascending
+
+    int halfEdges() const { return (int)edgeOf.size(); }
+    int edges() const { return (int)edgeHalf.size(); }
+
+    static int tri(int h) { return h / 3; }
+    static int next(int h) { return h - h % 3 + (h % 3 + 1) % 3; }
+    static int prev(int h) { return h - h % 3 + (h % 3 + 2) % 3; }
   };
 
+  struct TriGeometry;
+
   struct ObjPolys {
     tinyobj::attrib_t attrib;
-    std::vector<std::vector<tinyobj::index_t>> polys;
+    Csr<tinyobj::index_t> polys; // corners of each face
     int nV_in = 0;
     int nVT_in = 0;
   };
 
-  bool loadObjAsPolys(const std::string& objPath, ObjPolys& out);
+  bool loadObjAsPolys(const std::string& objPath, ObjPolys& out, int threads);
 
-  int getVT(const tinyobj::index_t& idx, int nVT_in);
+  // Spreads the low 21 bits of x to every third bit, for interleaving three axes into a Morton code
+  uint64_t spreadBits3(uint64_t x);
 
-  std::vector<std::vector<int>> buildUvNeighbors(const ObjPolys& m);
-  std::vector<int> computeFaceIslandsBfs(const std::vector<std::vector<int>>& neighbors);
+  // Sorts faces by the Morton code of their centroid over the bounding box and renumbers vertices and
+  // texcoords in order of first use, so the gathers of later stages and the baked output follow the surface
+  // instead of the file order. Ties keep the file order.
+  void reorderPolysMorton(ObjPolys& m, int threads);
 
-  std::vector<UvIsland> scoreIslandsAxis(const ObjPolys& m, const std::vector<int>& polyIsland);
+  int getVT(const tinyobj::index_t& idx, int nVT_in);
 
   std::vector<Tri> triangulate(const ObjPolys& m);
 
-  void computeTriNormalsAndAreas(
-      const ObjPolys& m, const std::vector<Tri>& tris, std::vector<Eigen::Vector3d>& triN, std::vector<double>& triA
+  // Stages taking a scratch resource allocate their temporaries from it, their results from the heap
+  MeshTopology buildTopology(
+      const ObjPolys& m,
+      const std::vector<Tri>& tris,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()
+  );
+
+  // Faces sharing a polygon edge with the first face that has it, when both use the same texcoords there
+  Csr<int> buildUvNeighbors(const ObjPolys& m, const std::vector<Tri>& tris, const MeshTopology& topo);
+
+  // UV island of every face: the components of the buildUvNeighbors graph, numbered in order of their
+  // smallest face. Found with a concurrent union-find, the result does not depend on the thread count.
+  std::vector<int> computeFaceIslands(
+      const ObjPolys& m,
+      const std::vector<Tri>& tris,
+      const MeshTopology& topo,
+      int threads,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()
+  );
+
+  std::vector<UvIsland> scoreIslandsAxis(
+      const ObjPolys& m,
+      const TriGeometry& geom,
+      const std::vector<int>& polyIsland,
+      int threads
   );
 
-  std::unordered_map<EdgeKey, std::pair<int, int>, EdgeKeyHash> buildEdgeToTris(const std::vector<Tri>& tris);
+  // Per edge of topo: 1 if the normals of its first two triangles differ by more than the threshold.
+  // Empty when crease splitting is off.
+  std::vector<uint8_t> computeCreaseEdges(
+      const MeshTopology& topo,
+      const TriGeometry& geom,
+      double creaseThresholdAngleDeg,
+      int threads
+  );
 
-  std::unordered_set<EdgeKey, EdgeKeyHash> computeCreaseEdges(
-      const std::unordered_map<EdgeKey, std::pair<int, int>, EdgeKeyHash>& edgeToTris,
-      const std::vector<Eigen::Vector3d>& triN,
-      double creaseThresholdAngleDeg
+  // Smoothing group of every corner in ObjPolys::polys.items, numbered per input vertex. Triangles around
+  // a vertex share a group when they are connected across non-crease edges at that vertex.
+  std::vector<int> computeCornerSmoothingGroups(
+      const ObjPolys& m,
+      const std::vector<Tri>& tris,
+      const MeshTopology& topo,
+      const std::vector<uint8_t>& creaseEdge
   );
 
   struct SplitMesh {
     std::vector<Eigen::Vector3d> outPos;
-    std::vector<std::vector<int>> outFaces;
-    std::vector<std::vector<int>> polyOutCorner;
+    std::vector<int> cornerOut; // output vertex of each corner in ObjPolys::polys.items
   };
 
   SplitMesh buildSplitMesh(
       const ObjPolys& m,
       const std::vector<Tri>& tris,
-      const std::unordered_set<EdgeKey, EdgeKeyHash>& creaseEdges,
-      double creaseThresholdAngleDeg
+      const MeshTopology& topo,
+      const std::vector<uint8_t>& creaseEdge,
+      double creaseThresholdAngleDeg,
+      int threads,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()
   );
 
-  std::vector<std::vector<int>> buildAdjacencyVec(const std::vector<std::vector<int>>& outFaces, int nV_out);
+  // Output vertex adjacency along polygon edges. Edges shared by two faces appear twice.
+  Csr<int> buildAdjacencyVec(
+      const std::vector<Tri>& tris,
+      const MeshTopology& topo,
+      const std::vector<int>& cornerOut,
+      int nV_out,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()
+  );
 
+  // Specialized at compile time on the axis mode and on float or double sums (singlePrecision), so the
+  // inner loops carry no mode branches. Float sums are about 10% faster and move the flow by about 1e-6 rad,
+  // but where the tangent contributions nearly cancel they can pick the opposite sign.
   void accumulateNormalsAndTangents(
-      const ObjPolys& m,
       const std::vector<Tri>& tris,
       const std::vector<int>& polyIsland,
       const std::vector<UvIsland>& islands,
       char axisSetting,
-      const std::vector<Eigen::Vector3d>& triN,
-      const std::vector<double>& triA,
-      const std::vector<std::vector<int>>& polyOutCorner,
+      const TriGeometry& geom,
+      const std::vector<int>& cornerOut,
       int nV_out,
       std::vector<Eigen::Vector3d>& vNormal,
       std::vector<Eigen::Vector3d>& vTangent,
-      std::vector<double>& vWeight
+      std::vector<double>& vWeight,
+      int threads,
+      bool singlePrecision = false,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()
   );
 
   std::vector<Eigen::Vector3d> buildFlowFromAccum(
       const std::vector<Eigen::Vector3d>& vNormal,
       const std::vector<Eigen::Vector3d>& vTangent,
       const std::vector<double>& vWeight,
-      const std::vector<std::vector<int>>& adj
+      const Csr<int>& adj,
+      int threads,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()
   );
 
   void packInterleavedVertices(
       const std::vector<Eigen::Vector3d>& outPos,
       const std::vector<Eigen::Vector3d>& outFlow,
-      std::vector<float>& outVert
+      std::vector<float>& outVert,
+      int threads
   );
 
-  void packTriangleIndices(const std::vector<std::vector<int>>& polyOutCorner, std::vector<unsigned int>& outInd);
+  void packTriangleIndices(const ObjPolys& m, const std::vector<int>& cornerOut, std::vector<unsigned int>& outInd);
 
 } // namespace flowfield::detail
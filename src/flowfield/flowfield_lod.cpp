@@ -0,0 +1,529 @@
+#include "flowfield_lod.hpp"
+
+#include "flowfield_detail.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <queue>
+
+using namespace flowfield::detail;
+
+// Border edges are kept in place by a plane through the edge, perpendicular to its triangle
+static constexpr double borderEdgeWeight = 10.0;
+// A collapse may turn a remaining triangle by at most acos(minFlipDot)
+static constexpr double minFlipDot = 0.2;
+
+enum class VertexKind : uint8_t { Manifold, Border, Locked };
+
+// Sum of squared distances to weighted planes, as x^T A x + 2 b^T x + c
+struct Quadric {
+  double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+  double b0 = 0, b1 = 0, b2 = 0;
+  double c = 0;
+  double weight = 0;
+
+  void addPlane(const Eigen::Vector3d& n, double d, double w) {
+    a00 += w * n.x() * n.x();
+    a01 += w * n.x() * n.y();
+    a02 += w * n.x() * n.z();
+    a11 += w * n.y() * n.y();
+    a12 += w * n.y() * n.z();
+    a22 += w * n.z() * n.z();
+    b0 += w * n.x() * d;
+    b1 += w * n.y() * d;
+    b2 += w * n.z() * d;
+    c += w * d * d;
+    weight += w;
+  }
+
+  void add(const Quadric& q) {
+    a00 += q.a00;
+    a01 += q.a01;
+    a02 += q.a02;
+    a11 += q.a11;
+    a12 += q.a12;
+    a22 += q.a22;
+    b0 += q.b0;
+    b1 += q.b1;
+    b2 += q.b2;
+    c += q.c;
+    weight += q.weight;
+  }
+
+  // Weighted mean squared distance of p to the planes
+  double error(const Eigen::Vector3d& p) const {
+    const double x = p.x(), y = p.y(), z = p.z();
+    const double e = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                   + 2 * (b0 * x + b1 * y + b2 * z) + c;
+    return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+  }
+};
+
+// Queued collapse of point p onto point q, the rank-th cheapest target of p. Stale once either point changed
+// after it was queued.
+struct Collapse {
+  double cost;
+  unsigned int p;
+  unsigned int q;
+  uint32_t versionP;
+  uint32_t versionQ;
+  uint32_t rank;
+
+  // Cheapest first, ties by points so the order does not depend on the heap layout
+  bool operator<(const Collapse& o) const {
+    if (cost != o.cost) return cost > o.cost;
+    return p != o.p ? p > o.p : q > o.q;
+  }
+};
+
+// Vertices of the bake that share a position (UV seams, crease splits, orientation seams) form one point.
+// Simplification works on points so splits stay closed: every vertex of a collapsing point moves onto the
+// vertex of the target point on the same side of the split.
+struct LodSimplifier {
+  const float* verts = nullptr;
+  size_t nV = 0;
+  size_t nP = 0;
+  double minFlowDot = 0;
+
+  std::vector<unsigned int> pointOf;
+  std::vector<Eigen::Vector3d> pointPos;
+  std::vector<Eigen::Vector3f> unitFlow; // per vertex, zero where the bake found none
+  std::vector<VertexKind> kind;
+  std::vector<Quadric> quadric;
+  FlatHashSet<EdgeKey, EdgeKeyHash> borderEdges{emptyEdgeKey};
+
+  // Current mesh: triangles over vertices and the live triangles around each point
+  std::vector<unsigned int> tris;
+  std::vector<uint8_t> triAlive;
+  size_t aliveTris = 0;
+  std::vector<std::vector<unsigned int>> pointTris;
+  std::vector<uint32_t> version;
+  std::priority_queue<Collapse> queue;
+  double errorSq = 0; // largest quadric error of any collapse so far
+
+  // Scratch
+  std::vector<uint32_t> ringMark;
+  uint32_t ringStamp = 0;
+  std::vector<unsigned int> ring;
+  std::vector<std::pair<unsigned int, unsigned int>> wedges;
+  std::vector<unsigned int> targets, partners;
+  std::vector<std::pair<double, unsigned int>> candidates;
+
+  static EdgeKey edgeKey(unsigned int a, unsigned int b) {
+    return a < b ? EdgeKey{(int)a, (int)b} : EdgeKey{(int)b, (int)a};
+  }
+
+  void init(const std::vector<unsigned int>& indices);
+  void queueBest(unsigned int p, uint32_t rank = 0);
+  bool evaluate(unsigned int p, unsigned int q, unsigned int a, unsigned int b, double& cost) const;
+  bool allowed(unsigned int p, unsigned int q);
+  void mapVertices(unsigned int p, unsigned int q);
+  bool flowTurns() const;
+  int sharedTriangles(unsigned int p, unsigned int q);
+  bool keepsOrientation(unsigned int p, unsigned int q) const;
+  void collapse(unsigned int p, unsigned int q);
+  bool simplify(size_t targetTris);
+  void appendAlive(std::vector<unsigned int>& out) const;
+};
+
+// Groups vertices into points, classifies the points and builds their quadrics from the full mesh
+void LodSimplifier::init(const std::vector<unsigned int>& indices) {
+  const size_t nT = indices.size() / 3;
+
+  std::vector<unsigned int> order(nV);
+  std::iota(order.begin(), order.end(), 0u);
+  auto samePos = [&](unsigned int a, unsigned int b) {
+    return std::memcmp(verts + (size_t)a * 6, verts + (size_t)b * 6, 3 * sizeof(float)) == 0;
+  };
+  std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+    const int c = std::memcmp(verts + (size_t)a * 6, verts + (size_t)b * 6, 3 * sizeof(float));
+    return c != 0 ? c < 0 : a < b;
+  });
+
+  pointOf.resize(nV);
+  pointPos.clear();
+  for (size_t i = 0; i < nV; ++i) {
+    if (i == 0 || !samePos(order[i - 1], order[i])) {
+      const float* v = verts + (size_t)order[i] * 6;
+      pointPos.emplace_back(v[0], v[1], v[2]);
+    }
+    pointOf[order[i]] = (unsigned int)(pointPos.size() - 1);
+  }
+  nP = pointPos.size();
+
+  unitFlow.resize(nV);
+  for (size_t v = 0; v < nV; ++v) {
+    const Eigen::Vector3f f(verts[v * 6 + 3], verts[v * 6 + 4], verts[v * 6 + 5]);
+    unitFlow[v] = f.squaredNorm() > 1e-12f ? Eigen::Vector3f(f.normalized()) : Eigen::Vector3f::Zero();
+  }
+
+  kind.assign(nP, VertexKind::Manifold);
+  quadric.assign(nP, Quadric());
+
+  // Undirected point edge use counts, 1 = border, more than 2 = non-manifold
+  FlatHashMap<EdgeKey, int, EdgeKeyHash> edgeUses(emptyEdgeKey, nT * 3 / 2);
+  for (size_t i = 0; i < nT * 3; ++i) {
+    const unsigned int a = pointOf[indices[i]], b = pointOf[indices[i - i % 3 + (i + 1) % 3]];
+    if (a == b) continue;
+    auto [uses, inserted] = edgeUses.tryEmplace(edgeKey(a, b), 0);
+    (*uses)++;
+  }
+
+  std::vector<uint8_t> borderDegree(nP, 0);
+  edgeUses.forEach([&](const EdgeKey& e, int uses) {
+    if (uses == 1) {
+      borderEdges.insert(e);
+      for (int p : {e.a, e.b}) borderDegree[p] = (uint8_t)std::min(borderDegree[p] + 1, 255);
+    } else if (uses > 2) {
+      kind[e.a] = kind[e.b] = VertexKind::Locked;
+    }
+  });
+  for (size_t p = 0; p < nP; ++p) {
+    if (borderDegree[p] == 0 || kind[p] == VertexKind::Locked) continue;
+    kind[p] = borderDegree[p] == 2 ? VertexKind::Border : VertexKind::Locked;
+  }
+
+  // Triangles that are degenerate in points never render and would only get in the way
+  tris.clear();
+  pointTris.assign(nP, {});
+  for (size_t t = 0; t < nT; ++t) {
+    const unsigned int* tri = indices.data() + t * 3;
+    const unsigned int pt[3] = {pointOf[tri[0]], pointOf[tri[1]], pointOf[tri[2]]};
+    if (pt[0] == pt[1] || pt[1] == pt[2] || pt[2] == pt[0]) continue;
+
+    const unsigned int id = (unsigned int)(tris.size() / 3);
+    tris.insert(tris.end(), tri, tri + 3);
+    for (unsigned int p : pt) pointTris[p].push_back(id);
+
+    const Eigen::Vector3d& p0 = pointPos[pt[0]];
+    const Eigen::Vector3d c = (pointPos[pt[1]] - p0).cross(pointPos[pt[2]] - p0);
+    const double dblA = c.norm();
+    if (dblA < 1e-20) continue;
+
+    const Eigen::Vector3d n = c / dblA;
+    Quadric q;
+    q.addPlane(n, -n.dot(p0), 0.5 * dblA);
+    for (int k = 0; k < 3; ++k) quadric[pt[k]].add(q);
+
+    for (int k = 0; k < 3; ++k) {
+      const unsigned int a = pt[k], b = pt[(k + 1) % 3];
+      if (!borderEdges.contains(edgeKey(a, b))) continue;
+
+      const Eigen::Vector3d e = pointPos[b] - pointPos[a];
+      const Eigen::Vector3d en = safeNormalize(e.cross(n));
+      Quadric qe;
+      qe.addPlane(en, -en.dot(pointPos[a]), borderEdgeWeight * e.squaredNorm());
+      quadric[a].add(qe);
+      quadric[b].add(qe);
+    }
+  }
+
+  triAlive.assign(tris.size() / 3, 1);
+  aliveTris = tris.size() / 3;
+  version.assign(nP, 0);
+  ringMark.assign(nP, 0);
+
+  for (unsigned int p = 0; p < nP; ++p) queueBest(p);
+}
+
+// Queues the rank-th cheapest target of p by cost alone. The topology and flow checks are left to allowed()
+// once the collapse comes up, so the many candidates that are requeued before they come up never pay for
+// them. The candidates only depend on the triangles around p and q, so the ranking stays the same until
+// either point changes.
+void LodSimplifier::queueBest(unsigned int p, uint32_t rank) {
+  candidates.clear();
+  for (unsigned int t : pointTris[p]) {
+    const unsigned int* tri = tris.data() + (size_t)t * 3;
+    int k = 0;
+    while (pointOf[tri[k]] != p) k++;
+
+    for (int d : {1, 2}) {
+      const unsigned int b = tri[(k + d) % 3];
+      double cost;
+      if (evaluate(p, pointOf[b], tri[k], b, cost)) candidates.emplace_back(cost, pointOf[b]);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  // Each target only with its cheapest cost
+  uint32_t distinct = 0;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    const auto [cost, q] = candidates[i];
+    auto sameQ = [q = q](const std::pair<double, unsigned int>& c) { return c.second == q; };
+    if (std::any_of(candidates.begin(), candidates.begin() + i, sameQ)) continue;
+    if (distinct++ == rank) {
+      queue.push(Collapse{cost, p, q, version[p], version[q], rank});
+      return;
+    }
+  }
+}
+
+// Cost of moving p onto q, seen from the triangle where vertex a of p meets vertex b of q. False if p may
+// not move there. The flow term only compares a and b, the other vertices of p are checked by flowTurns.
+bool LodSimplifier::evaluate(
+    unsigned int p,
+    unsigned int q,
+    unsigned int a,
+    unsigned int b,
+    double& cost
+) const {
+  if (kind[p] == VertexKind::Locked) return false;
+  if (kind[p] == VertexKind::Border && (kind[q] == VertexKind::Manifold || !borderEdges.contains(edgeKey(p, q)))) {
+    return false;
+  }
+
+  // Vertices without flow take on their partner's
+  const double flowDot = (unitFlow[a].isZero() || unitFlow[b].isZero()) ? 1.0 : (double)unitFlow[a].dot(unitFlow[b]);
+  if (flowDot < minFlowDot) return false;
+
+  Quadric sum = quadric[p];
+  sum.add(quadric[q]);
+  cost = sum.error(pointPos[q]) + (1.0 - flowDot) * (pointPos[q] - pointPos[p]).squaredNorm();
+  return true;
+}
+
+// Whether p may move onto q without flipping a triangle, changing the topology or turning the flow too far.
+// Leaves the wedges of the collapse in place.
+bool LodSimplifier::allowed(unsigned int p, unsigned int q) {
+  if (!keepsOrientation(p, q) || sharedTriangles(p, q) <= 0) return false;
+  mapVertices(p, q);
+  return !flowTurns();
+}
+
+// Pairs every vertex of p with the vertex of q it moves onto, into wedges. A vertex of p that shares
+// triangles with exactly one vertex of q stays on that side of the split. Otherwise the split does not run
+// along the edge (crease splits fragment dense scans into small fans) and it takes the vertex of q with the
+// closest flow, which is all the baked output keeps of a split; flowTurns bounds the difference.
+void LodSimplifier::mapVertices(unsigned int p, unsigned int q) {
+  constexpr unsigned int none = ~0u;
+
+  wedges.clear();
+  bool single = true; // one vertex of p, always next to the same vertex of q
+  for (unsigned int t : pointTris[p]) {
+    const unsigned int* tri = tris.data() + (size_t)t * 3;
+    unsigned int from = none, to = none;
+    for (int k = 0; k < 3; ++k) {
+      if (pointOf[tri[k]] == p) from = tri[k];
+      else if (pointOf[tri[k]] == q) to = tri[k];
+    }
+    if (!wedges.empty()) {
+      single &= from == wedges[0].first && (to == none || wedges[0].second == none || to == wedges[0].second);
+    }
+    if (to != none && !wedges.empty() && wedges[0].second == none) std::swap(wedges[0].second, to);
+    wedges.emplace_back(from, to);
+  }
+  if (single && !wedges.empty() && wedges[0].second != none) {
+    wedges.resize(1);
+    return;
+  }
+
+  targets.clear();
+  for (unsigned int t : pointTris[q]) {
+    const unsigned int* tri = tris.data() + (size_t)t * 3;
+    for (int k = 0; k < 3; ++k) {
+      if (pointOf[tri[k]] == q) targets.push_back(tri[k]);
+    }
+  }
+  std::sort(targets.begin(), targets.end());
+  targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+  auto closestFlow = [&](unsigned int from, const unsigned int* first, const unsigned int* last) {
+    unsigned int best = *first;
+    double bestDot = -2.0;
+    for (const unsigned int* it = first; it != last; ++it) {
+      const double d = unitFlow[from].dot(unitFlow[*it]);
+      if (d > bestDot) {
+        bestDot = d;
+        best = *it;
+      }
+    }
+    return best;
+  };
+
+  std::sort(wedges.begin(), wedges.end());
+  wedges.erase(std::unique(wedges.begin(), wedges.end()), wedges.end());
+
+  // Per vertex of p, its partners come first (ascending) and a triangle without q last
+  size_t out = 0;
+  for (size_t i = 0; i < wedges.size();) {
+    const unsigned int from = wedges[i].first;
+    size_t j = i;
+    partners.clear();
+    while (j < wedges.size() && wedges[j].first == from) {
+      if (wedges[j].second != none) partners.push_back(wedges[j].second);
+      j++;
+    }
+
+    unsigned int to;
+    if (partners.size() == 1) to = partners[0];
+    else if (!partners.empty()) to = closestFlow(from, partners.data(), partners.data() + partners.size());
+    else to = closestFlow(from, targets.data(), targets.data() + targets.size());
+
+    wedges[out++] = {from, to};
+    i = j;
+  }
+  wedges.resize(out);
+}
+
+// Whether any wedge turns the flow by more than maxFlowAngle
+bool LodSimplifier::flowTurns() const {
+  for (const auto& [from, to] : wedges) {
+    if (unitFlow[from].isZero() || unitFlow[to].isZero()) continue;
+    if (unitFlow[from].dot(unitFlow[to]) < minFlowDot) return true;
+  }
+  return false;
+}
+
+// Number of triangles with both p and q, or -1 if the collapse would merge the rings of p and q anywhere
+// else (the link condition), which would pinch the surface into a non-manifold edge or vertex
+int LodSimplifier::sharedTriangles(unsigned int p, unsigned int q) {
+  // Ring points of q carry ringStamp, common ring points counted once are bumped to ringStamp + 1
+  ringStamp += 2;
+  for (unsigned int t : pointTris[q]) {
+    for (int k = 0; k < 3; ++k) ringMark[pointOf[tris[(size_t)t * 3 + k]]] = ringStamp;
+  }
+
+  int shared = 0, common = 0;
+  for (unsigned int t : pointTris[p]) {
+    const unsigned int* tri = tris.data() + (size_t)t * 3;
+    for (int k = 0; k < 3; ++k) {
+      const unsigned int x = pointOf[tri[k]];
+      if (x == q) shared++;
+      if (x == p || x == q || ringMark[x] != ringStamp) continue;
+      ringMark[x] = ringStamp + 1;
+      common++;
+    }
+  }
+
+  return common == shared ? shared : -1;
+}
+
+// Whether every triangle of p that survives keeps facing the same way once p sits on q
+bool LodSimplifier::keepsOrientation(unsigned int p, unsigned int q) const {
+  for (unsigned int t : pointTris[p]) {
+    const unsigned int* tri = tris.data() + (size_t)t * 3;
+    const unsigned int pt[3] = {pointOf[tri[0]], pointOf[tri[1]], pointOf[tri[2]]};
+    if (pt[0] == q || pt[1] == q || pt[2] == q) continue;
+
+    Eigen::Vector3d a[3], b[3];
+    for (int k = 0; k < 3; ++k) {
+      a[k] = pointPos[pt[k]];
+      b[k] = pt[k] == p ? pointPos[q] : a[k];
+    }
+    const Eigen::Vector3d before = (a[1] - a[0]).cross(a[2] - a[0]);
+    const Eigen::Vector3d after = (b[1] - b[0]).cross(b[2] - b[0]);
+
+    if (after.dot(before) <= minFlipDot * after.norm() * before.norm()) return false;
+  }
+  return true;
+}
+
+// Moves p onto q along the wedges from mapVertices and requeues the edges whose cost or validity changed
+void LodSimplifier::collapse(unsigned int p, unsigned int q) {
+  Quadric sum = quadric[p];
+  sum.add(quadric[q]);
+  errorSq = std::max(errorSq, sum.error(pointPos[q]));
+  quadric[q] = sum;
+
+  for (unsigned int t : pointTris[p]) {
+    unsigned int* tri = tris.data() + (size_t)t * 3;
+    bool hasQ = false;
+    for (int k = 0; k < 3; ++k) hasQ |= pointOf[tri[k]] == q;
+    if (hasQ) {
+      triAlive[t] = 0;
+      aliveTris--;
+      continue;
+    }
+
+    for (int k = 0; k < 3; ++k) {
+      if (pointOf[tri[k]] != p) continue;
+      for (const auto& [from, to] : wedges) {
+        if (tri[k] == from) tri[k] = to;
+      }
+    }
+    pointTris[q].push_back(t);
+  }
+  pointTris[p].clear();
+
+  // Every point around q lost or gained triangles, q also changed its quadric
+  auto dropDead = [&](std::vector<unsigned int>& list) {
+    list.erase(std::remove_if(list.begin(), list.end(), [&](unsigned int t) { return !triAlive[t]; }), list.end());
+  };
+  dropDead(pointTris[q]);
+
+  ring.clear();
+  for (unsigned int t : pointTris[q]) {
+    for (int k = 0; k < 3; ++k) ring.push_back(pointOf[tris[(size_t)t * 3 + k]]);
+  }
+  std::sort(ring.begin(), ring.end());
+  ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+
+  version[p]++;
+  for (unsigned int x : ring) {
+    version[x]++;
+    dropDead(pointTris[x]);
+  }
+  for (unsigned int x : ring) queueBest(x);
+}
+
+// Collapses the cheapest edges until at most targetTris triangles remain. False if it runs out of collapses
+// first.
+bool LodSimplifier::simplify(size_t targetTris) {
+  while (aliveTris > targetTris) {
+    if (queue.empty()) return false;
+    const Collapse c = queue.top();
+    queue.pop();
+    if (c.versionP != version[c.p] || c.versionQ != version[c.q]) continue;
+
+    if (!allowed(c.p, c.q)) {
+      queueBest(c.p, c.rank + 1);
+      continue;
+    }
+    collapse(c.p, c.q);
+  }
+  return true;
+}
+
+void LodSimplifier::appendAlive(std::vector<unsigned int>& out) const {
+  for (size_t t = 0; t < triAlive.size(); ++t) {
+    if (triAlive[t]) out.insert(out.end(), tris.begin() + t * 3, tris.begin() + t * 3 + 3);
+  }
+}
+
+std::vector<FlowfieldLod> BuildFlowfieldLods(
+    const std::vector<float>& verts,
+    std::vector<unsigned int>& indices,
+    const FlowfieldLodSettings& settings
+) {
+  TRACE_ZONE("BuildFlowfieldLods");
+  std::vector<FlowfieldLod> lods;
+  lods.push_back(FlowfieldLod{0, (uint32_t)indices.size(), 0.0f});
+  if (settings.maxLevels <= 0 || indices.size() / 3 <= settings.minTriangles) return lods;
+
+  LodSimplifier s;
+  s.verts = verts.data();
+  s.nV = verts.size() / 6;
+  s.minFlowDot = std::cos(deg2rad(settings.maxFlowAngle));
+  s.init(indices);
+
+  for (int level = 1; level <= settings.maxLevels; ++level) {
+    const size_t prevTris = lods.back().indexCount / 3;
+    const size_t targetTris = std::max((size_t)(prevTris * settings.reduction), settings.minTriangles);
+    if (targetTris >= prevTris) break;
+
+    const bool reached = s.simplify(targetTris);
+
+    // Stop once the locked points and flow limits hold back more than half of the intended reduction
+    if (2 * (prevTris - s.aliveTris) < prevTris - targetTris) break;
+
+    const float error = (float)std::sqrt(s.errorSq);
+    lods.push_back(FlowfieldLod{(uint32_t)indices.size(), (uint32_t)(s.aliveTris * 3), error});
+    s.appendAlive(indices);
+    if (!reached) break;
+  }
+
+  return lods;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "flowfield.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Level of detail chain for baked flowfield meshes.
+//
+// Levels are snapshots of one sequence of half-edge collapses that move a vertex onto a neighbor, so every
+// level indexes the same vertex buffer and only adds an index list. Collapses are ordered by a quadric error
+// of the full mesh surface plus a penalty for turning the flow. Vertices that share their position (UV
+// seams, crease splits, orientation seams) move together so the splits stay closed, complex border vertices
+// never move, border vertices only slide along the border, and a collapse is rejected when the flow would
+// turn by more than maxFlowAngle, a triangle would flip or the topology would change.
+
+struct FlowfieldLodSettings {
+  int maxLevels = 4;         // simplified levels after the full mesh
+  float reduction = 0.5f;    // triangle count of a level relative to the previous one
+  size_t minTriangles = 512; // no level is simplified below this many triangles
+  float maxFlowAngle = 30.0f;
+};
+
+// Appends the index lists of the simplified levels to indices and returns the level table, with the full
+// mesh (the indices as passed in) as level 0. verts is the interleaved position + flow layout of the bake.
+// The chain ends early once a level can no longer be reduced noticeably.
+std::vector<FlowfieldLod> BuildFlowfieldLods(
+    const std::vector<float>& verts,
+    std::vector<unsigned int>& indices,
+    const FlowfieldLodSettings& settings = {}
+);
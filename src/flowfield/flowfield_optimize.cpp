@@ -0,0 +1,160 @@
+#include "flowfield_optimize.hpp"
+
+#include "flowfield_detail.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+
+using namespace flowfield::detail;
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize) {
+  VertexCacheStats stats;
+  if (indexCount < 3 || cacheSize <= 0) return stats;
+
+  // A vertex is cached while fewer than cacheSize misses happened since it was last transformed
+  std::vector<size_t> missAt(vertexCount, 0);
+  std::vector<uint8_t> used(vertexCount, 0);
+  size_t misses = 0, unique = 0;
+
+  for (size_t i = 0; i < indexCount; ++i) {
+    const unsigned int v = indices[i];
+    if (!used[v]) {
+      used[v] = 1;
+      unique++;
+    } else if (misses - missAt[v] < (size_t)cacheSize) {
+      continue;
+    }
+    misses++;
+    missAt[v] = misses;
+  }
+
+  stats.acmr = (float)misses / (float)(indexCount / 3);
+  stats.atvr = unique > 0 ? (float)misses / (float)unique : 0.0f;
+  return stats;
+}
+
+VertexCacheStats AnalyzeFlowfieldMesh(
+    const unsigned int* indices,
+    size_t indexCount,
+    size_t vertexCount,
+    const FlowfieldLod* lods,
+    size_t lodCount
+) {
+  const size_t fullCount = lodCount > 0 ? lods[0].indexCount : indexCount;
+  return AnalyzeVertexCache(indices, fullCount, vertexCount);
+}
+
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize) {
+  TRACE_ZONE("OptimizeVertexCache");
+  const size_t nT = indexCount / 3;
+  if (nT < 2 || cacheSize <= 0) return;
+
+  // Vertex -> triangles, and the live (not yet emitted) triangle count per vertex
+  Csr<int> vt;
+  vt.offset.assign(vertexCount + 1, 0);
+  for (size_t i = 0; i < nT * 3; ++i) vt.offset[(size_t)indices[i] + 1]++;
+  for (size_t v = 0; v < vertexCount; ++v) vt.offset[v + 1] += vt.offset[v];
+  vt.items.resize(nT * 3);
+  std::vector<int> live(vertexCount);
+  {
+    std::vector<int> fill(vt.offset.begin(), vt.offset.end() - 1);
+    for (size_t i = 0; i < nT * 3; ++i) vt.items[(size_t)fill[indices[i]]++] = (int)(i / 3);
+    for (size_t v = 0; v < vertexCount; ++v) live[v] = vt.rowSize((int)v);
+  }
+
+  std::vector<unsigned int> out;
+  out.reserve(nT * 3);
+  std::vector<uint8_t> emitted(nT, 0);
+  std::vector<int> cachedAt(vertexCount, 0);
+  int time = cacheSize + 1;
+
+  std::vector<unsigned int> deadEnd; // recently used vertices, to resume from when a fan runs dry
+  std::vector<unsigned int> candidates;
+  size_t cursor = 0;
+
+  int fan = (int)indices[0];
+  while (fan >= 0) {
+    candidates.clear();
+    for (int t : vt.row(fan)) {
+      if (emitted[(size_t)t]) continue;
+      emitted[(size_t)t] = 1;
+      for (int k = 0; k < 3; ++k) {
+        const unsigned int v = indices[(size_t)t * 3 + k];
+        out.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - cachedAt[v] > cacheSize) cachedAt[v] = time++;
+      }
+    }
+
+    // Next fan: the candidate that stays longest in the cache while its remaining triangles are emitted,
+    // preferring older entries since they are evicted first
+    fan = -1;
+    int best = -1;
+    for (unsigned int v : candidates) {
+      if (live[v] <= 0) continue;
+      const int age = time - cachedAt[v];
+      const int priority = age + 2 * live[v] <= cacheSize ? age : 0;
+      if (priority > best) {
+        best = priority;
+        fan = (int)v;
+      }
+    }
+
+    while (fan < 0 && !deadEnd.empty()) {
+      const unsigned int v = deadEnd.back();
+      deadEnd.pop_back();
+      if (live[v] > 0) fan = (int)v;
+    }
+    while (fan < 0 && cursor < vertexCount) {
+      if (live[cursor] > 0) fan = (int)cursor;
+      cursor++;
+    }
+  }
+
+  std::copy(out.begin(), out.end(), indices);
+}
+
+void OptimizeVertexFetch(std::vector<float>& verts, std::vector<unsigned int>& indices) {
+  TRACE_ZONE("OptimizeVertexFetch");
+  const size_t nV = verts.size() / 6;
+  constexpr unsigned int unassigned = ~0u;
+
+  std::vector<unsigned int> remap(nV, unassigned);
+  unsigned int next = 0;
+  for (unsigned int& i : indices) {
+    if (remap[i] == unassigned) remap[i] = next++;
+    i = remap[i];
+  }
+  for (size_t v = 0; v < nV; ++v) {
+    if (remap[v] == unassigned) remap[v] = next++;
+  }
+
+  std::vector<float> reordered(verts.size());
+  for (size_t v = 0; v < nV; ++v) std::copy_n(verts.data() + v * 6, 6, reordered.data() + (size_t)remap[v] * 6);
+  verts.swap(reordered);
+}
+
+FlowfieldDrawOrderStats OptimizeFlowfieldMesh(
+    std::vector<float>& verts,
+    std::vector<unsigned int>& indices,
+    const std::vector<FlowfieldLod>& lods
+) {
+  TRACE_ZONE("OptimizeFlowfieldMesh");
+  const size_t nV = verts.size() / 6;
+
+  FlowfieldDrawOrderStats stats;
+  stats.before = AnalyzeFlowfieldMesh(indices.data(), indices.size(), nV, lods.data(), lods.size());
+
+  if (lods.empty()) {
+    OptimizeVertexCache(indices.data(), indices.size(), nV);
+  } else {
+    for (const FlowfieldLod& lod : lods) OptimizeVertexCache(indices.data() + lod.indexOffset, lod.indexCount, nV);
+  }
+
+  OptimizeVertexFetch(verts, indices);
+
+  stats.after = AnalyzeFlowfieldMesh(indices.data(), indices.size(), nV, lods.data(), lods.size());
+  return stats;
+}
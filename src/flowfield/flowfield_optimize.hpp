@@ -0,0 +1,47 @@
+#pragma once
+
+#include "flowfield.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Draw order optimization for baked flowfield meshes.
+//
+// The bake emits triangles in OBJ polygon order, which for scanned assets jumps around the surface and misses
+// the post-transform vertex cache. OptimizeVertexCache reorders the triangles of an index range with Tipsify
+// (Sander et al. 2007), which fans around recently used vertices and is linear in the triangle count.
+// OptimizeVertexFetch then renumbers the vertices in order of first use so the vertex fetch reads the buffer
+// front to back. Neither changes the rendered surface.
+
+// Post-transform vertex cache efficiency of an index range (VertexCacheStats is declared in flowfield.hpp)
+VertexCacheStats AnalyzeVertexCache(
+    const unsigned int* indices,
+    size_t indexCount,
+    size_t vertexCount,
+    int cacheSize = 16
+);
+
+// Same for the full mesh of a bake: level 0 when there are lods, otherwise all indices
+VertexCacheStats AnalyzeFlowfieldMesh(
+    const unsigned int* indices,
+    size_t indexCount,
+    size_t vertexCount,
+    const FlowfieldLod* lods = nullptr,
+    size_t lodCount = 0
+);
+
+// Reorders the triangles of indices[0, indexCount) in place, keeping each triangle's winding
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize = 16);
+
+// Renumbers the vertices of the interleaved position + flow layout in order of first use in indices and
+// rewrites indices to match. Unreferenced vertices move to the end.
+void OptimizeVertexFetch(std::vector<float>& verts, std::vector<unsigned int>& indices);
+
+// Optimizes every level of detail range for the vertex cache, then the shared vertex buffer for fetch in
+// the order of the full mesh. Without lods the whole index buffer is one range. Returns the vertex cache
+// efficiency of the full mesh before and after.
+FlowfieldDrawOrderStats OptimizeFlowfieldMesh(
+    std::vector<float>& verts,
+    std::vector<unsigned int>& indices,
+    const std::vector<FlowfieldLod>& lods = {}
+);
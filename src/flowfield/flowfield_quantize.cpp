@@ -0,0 +1,149 @@
+#include "flowfield_quantize.hpp"
+
+#include "flowfield_detail.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace flowfield::detail;
+
+static float signNotZero(float x) {
+  return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+static void octDecode(float u, float v, float out[3]) {
+  float x = u, y = v;
+  const float z = 1.0f - std::abs(u) - std::abs(v);
+  if (z < 0.0f) {
+    x = (1.0f - std::abs(v)) * signNotZero(u);
+    y = (1.0f - std::abs(u)) * signNotZero(v);
+  }
+  const float len = std::sqrt(x * x + y * y + z * z);
+  out[0] = x / len;
+  out[1] = y / len;
+  out[2] = z / len;
+}
+
+void DecodeOctahedral(const int16_t code[2], int bits, float out[3]) {
+  const float maxCode = (float)((1 << (bits - 1)) - 1);
+  octDecode(std::max(code[0] / maxCode, -1.0f), std::max(code[1] / maxCode, -1.0f), out);
+}
+
+void EncodeOctahedral(const float dir[3], int bits, int16_t out[2]) {
+  const float l1 = std::abs(dir[0]) + std::abs(dir[1]) + std::abs(dir[2]);
+  if (!(l1 > 0.0f)) {
+    out[0] = out[1] = 0;
+    return;
+  }
+
+  float u = dir[0] / l1, v = dir[1] / l1;
+  if (dir[2] < 0.0f) {
+    const float pu = u;
+    u = (1.0f - std::abs(v)) * signNotZero(pu);
+    v = (1.0f - std::abs(pu)) * signNotZero(v);
+  }
+
+  // Rounding each component on its own can land on a worse neighbor near the octahedron's edges
+  const int maxCode = (1 << (bits - 1)) - 1;
+  const float cu = std::floor(u * maxCode), cv = std::floor(v * maxCode);
+  const float invLen = 1.0f / std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+  float bestDot = -2.0f;
+  for (int du = 0; du < 2; ++du) {
+    for (int dv = 0; dv < 2; ++dv) {
+      const int16_t code[2] = {
+          (int16_t)std::clamp((int)cu + du, -maxCode, maxCode),
+          (int16_t)std::clamp((int)cv + dv, -maxCode, maxCode),
+      };
+      float d[3];
+      DecodeOctahedral(code, bits, d);
+      const float dot = (d[0] * dir[0] + d[1] * dir[1] + d[2] * dir[2]) * invLen;
+      if (dot > bestDot) {
+        bestDot = dot;
+        out[0] = code[0];
+        out[1] = code[1];
+      }
+    }
+  }
+}
+
+bool QuantizeFlowfieldMesh(
+    const float* verts,
+    size_t vertFloatCount,
+    const unsigned int* indices,
+    size_t indexCount,
+    int flowBits,
+    QuantizedFlowfieldMesh& out
+) {
+  TRACE_ZONE("QuantizeFlowfieldMesh");
+  if (flowBits != 8 && flowBits != 16) return false;
+
+  out = QuantizedFlowfieldMesh();
+  const size_t nV = vertFloatCount / 6;
+  out.vertexCount = nV;
+  out.flowBits = flowBits;
+  out.stride = flowBits == 16 ? 12 : 8;
+  out.flowOffset = flowBits == 16 ? 8 : 6;
+  if (nV == 0) return true;
+
+  float hi[3];
+  for (int c = 0; c < 3; ++c) out.boundsMin[c] = hi[c] = verts[c];
+  for (size_t v = 0; v < nV; ++v) {
+    for (int c = 0; c < 3; ++c) {
+      out.boundsMin[c] = std::min(out.boundsMin[c], verts[v * 6 + c]);
+      hi[c] = std::max(hi[c], verts[v * 6 + c]);
+    }
+  }
+  for (int c = 0; c < 3; ++c) out.boundsExtent[c] = hi[c] - out.boundsMin[c];
+
+  out.vertexData.assign(nV * out.stride, 0);
+  double maxPosErrSq = 0.0;
+  double maxFlowAngle = 0.0;
+
+  for (size_t v = 0; v < nV; ++v) {
+    const float* src = verts + v * 6;
+    uint8_t* dst = out.vertexData.data() + v * out.stride;
+
+    uint16_t q[3];
+    double errSq = 0.0;
+    for (int c = 0; c < 3; ++c) {
+      const float e = out.boundsExtent[c];
+      const float t = e > 0.0f ? (src[c] - out.boundsMin[c]) / e : 0.0f;
+      q[c] = (uint16_t)std::clamp((int)std::lround(t * 65535.0f), 0, 65535);
+      const float decoded = out.boundsMin[c] + (q[c] / 65535.0f) * e;
+      errSq += (double)(decoded - src[c]) * (decoded - src[c]);
+    }
+    std::memcpy(dst, q, sizeof(q));
+    maxPosErrSq = std::max(maxPosErrSq, errSq);
+
+    int16_t code[2];
+    EncodeOctahedral(src + 3, flowBits, code);
+    if (flowBits == 16) {
+      std::memcpy(dst + out.flowOffset, code, sizeof(code));
+    } else {
+      const int8_t narrow[2] = {(int8_t)code[0], (int8_t)code[1]};
+      std::memcpy(dst + out.flowOffset, narrow, sizeof(narrow));
+    }
+
+    if (!(std::abs(src[3]) + std::abs(src[4]) + std::abs(src[5]) > 0.0f)) {
+      out.zeroFlows++;
+      continue;
+    }
+    // atan2 of the cross and dot products stays accurate for the tiny angles of 16-bit codes
+    float d[3];
+    DecodeOctahedral(code, flowBits, d);
+    const double cx = (double)d[1] * src[5] - (double)d[2] * src[4];
+    const double cy = (double)d[2] * src[3] - (double)d[0] * src[5];
+    const double cz = (double)d[0] * src[4] - (double)d[1] * src[3];
+    const double dot = (double)d[0] * src[3] + (double)d[1] * src[4] + (double)d[2] * src[5];
+    maxFlowAngle = std::max(maxFlowAngle, std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot));
+  }
+
+  out.maxPositionError = (float)std::sqrt(maxPosErrSq);
+  out.maxFlowErrorDeg = (float)(maxFlowAngle / deg2rad(1.0));
+
+  if (nV <= 65536) out.shortIndices.assign(indices, indices + indexCount);
+
+  return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compact vertex and index formats for baked flowfield meshes.
+//
+// Positions are stored as 16-bit unsigned normalized values relative to the bounding box, so they decode as
+// boundsMin + p * boundsExtent. The unit flow direction is octahedrally encoded (Cigolle et al. 2014) into
+// two signed normalized components of flowBits (16 or 8) bits, picking the code among the rounding
+// candidates that decodes closest to the input. Indices are narrowed to 16 bits when the vertex count
+// allows. Vertex layout, tightly packed per vertex:
+//   flowBits 16: uint16 x, y, z, pad | int16 u, v   (12 bytes)
+//   flowBits 8:  uint16 x, y, z      | int8 u, v    (8 bytes)
+// Flow vectors of zero length have no direction and decode as +Z.
+
+struct QuantizedFlowfieldMesh {
+  std::vector<uint8_t> vertexData;
+  size_t vertexCount = 0;
+  size_t stride = 0;
+  size_t flowOffset = 0; // byte offset of the flow components in a vertex
+  int flowBits = 16;
+  std::vector<uint16_t> shortIndices; // empty when the vertex count needs 32-bit indices
+
+  float boundsMin[3] = {0.0f, 0.0f, 0.0f};
+  float boundsExtent[3] = {0.0f, 0.0f, 0.0f};
+
+  // Measured against the float input
+  float maxPositionError = 0.0f; // largest distance of a decoded position, in model units
+  float maxFlowErrorDeg = 0.0f;  // largest angle between a decoded and the input flow direction
+  size_t zeroFlows = 0;          // vertices without a flow direction
+
+  bool empty() const { return vertexCount == 0; }
+};
+
+// verts is the interleaved position + flow layout of the bake. False if flowBits is not 8 or 16.
+bool QuantizeFlowfieldMesh(
+    const float* verts,
+    size_t vertFloatCount,
+    const unsigned int* indices,
+    size_t indexCount,
+    int flowBits,
+    QuantizedFlowfieldMesh& out
+);
+
+// Octahedral encoding of a unit direction into two signed normalized components of the given bit count,
+// and its decoding with the rounding rules of GL signed normalized attributes. Exposed to match the shader.
+void EncodeOctahedral(const float dir[3], int bits, int16_t out[2]);
+void DecodeOctahedral(const int16_t code[2], int bits, float out[3]);
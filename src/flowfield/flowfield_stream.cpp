@@ -0,0 +1,815 @@
+#include "flowfield_stream.hpp"
+
+#include "flowfield_detail.hpp"
+#include "mapped_file.hpp"
+#include "obj_parser.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include "tri_geometry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <type_traits>
+
+using namespace flowfield::detail;
+
+// Peak memory of the in-memory pipeline per triangle, about 400 bytes on the bundled models
+static constexpr size_t bytesPerTriangle = 512;
+// Faces are binned into a grid of 2^gridBits cells per axis, which are then grouped into chunks in Morton order
+static constexpr int gridBits = 6;
+// Flows on either side of a chunk border only decide the relative orientation if they are this parallel
+static constexpr double minOrientationDot = 0.5;
+
+// Growable array in a SpillFile. Elements are raw bytes, data() moves when the array grows.
+template<typename T>
+struct SpillArray {
+  static_assert(std::is_trivially_copyable<T>::value, "spill arrays are not constructed or destroyed");
+
+  SpillFile file;
+  size_t count = 0;
+
+  bool create(const std::string& path) { return file.Create(path); }
+
+  bool resize(size_t n) {
+    if (!file.Reserve(n * sizeof(T))) return false;
+    count = n;
+    return true;
+  }
+
+  bool append(const T* items, size_t n) {
+    if (n == 0) return true;
+    if (!file.Reserve((count + n) * sizeof(T))) return false;
+    std::memcpy(data() + count, items, n * sizeof(T));
+    count += n;
+    return true;
+  }
+
+  T* data() { return (T*)file.data; }
+  const T* data() const { return (const T*)file.data; }
+  size_t size() const { return count; }
+  T& operator[](size_t i) { return data()[i]; }
+  const T& operator[](size_t i) const { return data()[i]; }
+};
+
+// Geometry of one triangle as far as island scoring needs it
+struct TriScore {
+  float dPdu[3];
+  float dPdv[3];
+  float area;
+};
+
+struct IslandSum {
+  double sumU[3];
+  double sumV[3];
+  double sumUlen;
+  double sumVlen;
+};
+
+// Output vertex whose input vertex is used by more than one chunk
+struct BorderVertex {
+  int v, vt;
+  int chunk;
+  unsigned int out;
+};
+
+struct StreamingBake {
+  std::string spillPrefix;
+  int spillCount = 0;
+
+  // Parsed OBJ
+  SpillArray<tinyobj::real_t> positions;
+  SpillArray<tinyobj::real_t> texcoords;
+  SpillArray<tinyobj::index_t> corners;
+  SpillArray<int> faceOffset;
+
+  // Partition: the faces of chunk c are chunkFaces[chunkFaceOffset[c]] .. in ascending order
+  std::vector<int> chunkFaceOffset;
+  SpillArray<int> chunkFaces;
+  SpillArray<int> faceChunk;
+  SpillArray<int> vertexChunk; // chunk of the faces using a vertex, -1 for none, -2 for several
+  SpillArray<int> vertexFaceOffset;
+  SpillArray<int> vertexFaces;
+
+  // Local index of every vertex and texcoord of the chunk being gathered, -1 elsewhere
+  SpillArray<int> vertexLocal;
+  SpillArray<int> texcoordLocal;
+
+  // 'U' or 'V' per face, from the face's UV island
+  SpillArray<char> faceAxis;
+
+  // Output, plus the chunk-local flow component of every output vertex
+  SpillArray<float> outVerts;
+  SpillArray<unsigned int> outIndices;
+  SpillArray<int> outComp;
+  SpillArray<BorderVertex> border;
+  int compCount = 0;
+
+  int faces() const { return (int)faceOffset.size() - 1; }
+  int vertices() const { return (int)(positions.size() / 3); }
+
+  size_t spillBytes() const {
+    size_t bytes = 0;
+    for (const SpillFile* f :
+         {&positions.file, &texcoords.file, &corners.file, &faceOffset.file, &chunkFaces.file, &faceChunk.file,
+          &vertexChunk.file, &vertexFaceOffset.file, &vertexFaces.file, &vertexLocal.file, &texcoordLocal.file,
+          &faceAxis.file, &outVerts.file, &outIndices.file, &outComp.file, &border.file})
+      bytes += f->capacity;
+    return bytes;
+  }
+
+  template<typename T>
+  bool create(SpillArray<T>& a) {
+    return a.create(spillPrefix + "-" + std::to_string(spillCount++));
+  }
+};
+
+// Local mesh of one chunk. The chunk's own faces come first, then its halo, and vertices and texcoords are
+// numbered in ascending global order, so a single chunk reproduces the input exactly.
+struct ChunkMesh {
+  ObjPolys mesh;
+  std::vector<int> faces; // global face of each polygon
+  int ownFaces = 0;
+  std::vector<int> verts;     // global vertex of each local vertex
+  std::vector<int> texcoords; // global texcoord of each local texcoord
+};
+
+// Stages of a chunk that do not depend on the settings, kept between the island pass and the bake
+struct ChunkStages {
+  int chunk = -1;
+  ChunkMesh cm;
+  std::vector<Tri> tris;
+  MeshTopology topo;
+  TriGeometry geom;
+};
+
+static bool spillFailed() {
+  std::cerr << "Failed to grow spill file\n";
+  return false;
+}
+
+static bool parseInput(const std::string& objPath, size_t windowBytes, int threads, StreamingBake& b) {
+  if (!b.create(b.positions) || !b.create(b.texcoords) || !b.create(b.corners) || !b.create(b.faceOffset)) {
+    std::cerr << "Failed to create spill files: " << b.spillPrefix << "\n";
+    return false;
+  }
+
+  int offset = 0;
+  if (!b.faceOffset.append(&offset, 1)) return spillFailed();
+
+  std::vector<int> offsets;
+  const bool parsed = streamObjFile(objPath, windowBytes, threads, [&](const ObjBlock& block) {
+    offsets.resize(block.faceSize.size());
+    for (size_t f = 0; f < block.faceSize.size(); ++f) {
+      offset += block.faceSize[f];
+      offsets[f] = offset;
+    }
+
+    if (!b.positions.append(block.positions.data(), block.positions.size())
+        || !b.texcoords.append(block.texcoords.data(), block.texcoords.size())
+        || !b.corners.append(block.corners.data(), block.corners.size())
+        || !b.faceOffset.append(offsets.data(), offsets.size()))
+      return spillFailed();
+    return true;
+  });
+  if (!parsed) return false;
+
+  const int nV = b.vertices();
+  const int nVT = (int)(b.texcoords.size() / 2);
+  if (nV <= 0 || nVT <= 0) {
+    std::cerr << "OBJ must have positions and texcoords\n";
+    return false;
+  }
+
+  std::atomic<bool> indicesOk{true};
+  parallelFor(b.corners.size(), threads, [&](size_t begin, size_t end, int) {
+    bool ok = true;
+    for (size_t k = begin; k < end; ++k) {
+      const tinyobj::index_t& idx = b.corners[k];
+      ok &= idx.vertex_index >= 0 && idx.vertex_index < nV;
+      ok &= idx.texcoord_index >= -1 && idx.texcoord_index < nVT;
+    }
+    if (!ok) indicesOk = false;
+  });
+
+  if (!indicesOk) {
+    std::cerr << "OBJ has out of range indices: " << objPath << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+// Bins the faces into grid cells by centroid and cuts the cells, in Morton order, into chunks of at most
+// chunkTris triangles (unless a single cell holds more). Then builds the chunk face lists and the vertex
+// to face incidence that halos are gathered from.
+static bool partitionFaces(StreamingBake& b, size_t chunkTris, int threads) {
+  const int nF = b.faces();
+  const int nV = b.vertices();
+
+  const int blocks = parallelBlockCount((size_t)nV, threads);
+  std::vector<Eigen::Vector3f> blockMin((size_t)blocks, Eigen::Vector3f::Constant(INFINITY));
+  std::vector<Eigen::Vector3f> blockMax((size_t)blocks, Eigen::Vector3f::Constant(-INFINITY));
+  parallelFor((size_t)nV, threads, [&](size_t begin, size_t end, int block) {
+    for (size_t v = begin; v < end; ++v) {
+      const Eigen::Vector3f p(b.positions[v * 3], b.positions[v * 3 + 1], b.positions[v * 3 + 2]);
+      blockMin[(size_t)block] = blockMin[(size_t)block].cwiseMin(p);
+      blockMax[(size_t)block] = blockMax[(size_t)block].cwiseMax(p);
+    }
+  });
+
+  Eigen::Vector3f lo = blockMin[0], hi = blockMax[0];
+  for (int i = 1; i < blocks; ++i) {
+    lo = lo.cwiseMin(blockMin[(size_t)i]);
+    hi = hi.cwiseMax(blockMax[(size_t)i]);
+  }
+
+  const int cellsPerAxis = 1 << gridBits;
+  const Eigen::Vector3f extent = (hi - lo).cwiseMax(1e-20f);
+
+  if (!b.create(b.faceChunk) || !b.faceChunk.resize((size_t)nF)) return spillFailed();
+
+  // Morton code of the centroid cell, stored in faceChunk until the chunks are known
+  parallelFor((size_t)nF, threads, [&](size_t begin, size_t end, int) {
+    for (size_t f = begin; f < end; ++f) {
+      Eigen::Vector3f c = Eigen::Vector3f::Zero();
+      const int first = b.faceOffset[f], last = b.faceOffset[f + 1];
+      for (int k = first; k < last; ++k) {
+        const size_t v = (size_t)b.corners[(size_t)k].vertex_index;
+        c += Eigen::Vector3f(b.positions[v * 3], b.positions[v * 3 + 1], b.positions[v * 3 + 2]);
+      }
+      c /= (float)(last - first);
+
+      uint32_t code = 0;
+      for (int a = 0; a < 3; ++a) {
+        const int cell = (int)((c[a] - lo[a]) / extent[a] * (float)cellsPerAxis);
+        code |= (uint32_t)spreadBits3((uint64_t)std::clamp(cell, 0, cellsPerAxis - 1)) << a;
+      }
+      b.faceChunk[f] = (int)code;
+    }
+  });
+
+  const size_t cellCount = (size_t)1 << (3 * gridBits);
+  std::vector<size_t> cellTris(cellCount, 0);
+  for (int f = 0; f < nF; ++f) {
+    cellTris[(size_t)b.faceChunk[(size_t)f]] += (size_t)(b.faceOffset[(size_t)f + 1] - b.faceOffset[(size_t)f] - 2);
+  }
+
+  std::vector<int> cellChunk(cellCount, -1);
+  int chunkCount = 0;
+  size_t tris = 0;
+  for (size_t cell = 0; cell < cellCount; ++cell) {
+    if (cellTris[cell] == 0) continue;
+    if (chunkCount == 0 || (tris > 0 && tris + cellTris[cell] > chunkTris)) {
+      ++chunkCount;
+      tris = 0;
+    }
+    cellChunk[cell] = chunkCount - 1;
+    tris += cellTris[cell];
+  }
+
+  b.chunkFaceOffset.assign((size_t)chunkCount + 1, 0);
+  for (int f = 0; f < nF; ++f) {
+    int& chunk = b.faceChunk[(size_t)f];
+    chunk = cellChunk[(size_t)chunk];
+    b.chunkFaceOffset[(size_t)chunk + 1]++;
+  }
+  for (int c = 0; c < chunkCount; ++c) b.chunkFaceOffset[(size_t)c + 1] += b.chunkFaceOffset[(size_t)c];
+
+  if (!b.create(b.chunkFaces) || !b.chunkFaces.resize((size_t)nF)) return spillFailed();
+  {
+    std::vector<int> fill(b.chunkFaceOffset.begin(), b.chunkFaceOffset.end() - 1);
+    for (int f = 0; f < nF; ++f) b.chunkFaces[(size_t)fill[(size_t)b.faceChunk[(size_t)f]]++] = f;
+  }
+
+  if (!b.create(b.vertexChunk) || !b.vertexChunk.resize((size_t)nV)) return spillFailed();
+  if (!b.create(b.vertexFaceOffset) || !b.vertexFaceOffset.resize((size_t)nV + 1)) return spillFailed();
+  if (!b.create(b.vertexFaces) || !b.vertexFaces.resize(b.corners.size())) return spillFailed();
+
+  if (!b.create(b.vertexLocal) || !b.vertexLocal.resize((size_t)nV)) return spillFailed();
+  if (!b.create(b.texcoordLocal) || !b.texcoordLocal.resize(b.texcoords.size() / 2)) return spillFailed();
+
+  std::fill(b.vertexChunk.data(), b.vertexChunk.data() + nV, -1);
+  std::fill(b.vertexLocal.data(), b.vertexLocal.data() + nV, -1);
+  std::fill(b.texcoordLocal.data(), b.texcoordLocal.data() + b.texcoordLocal.size(), -1);
+  std::fill(b.vertexFaceOffset.data(), b.vertexFaceOffset.data() + nV + 1, 0);
+
+  for (int f = 0; f < nF; ++f) {
+    const int chunk = b.faceChunk[(size_t)f];
+    for (int k = b.faceOffset[(size_t)f]; k < b.faceOffset[(size_t)f + 1]; ++k) {
+      const size_t v = (size_t)b.corners[(size_t)k].vertex_index;
+      int& vc = b.vertexChunk[v];
+      vc = (vc == -1 || vc == chunk) ? chunk : -2;
+      b.vertexFaceOffset[v + 1]++;
+    }
+  }
+  for (int v = 0; v < nV; ++v) b.vertexFaceOffset[(size_t)v + 1] += b.vertexFaceOffset[(size_t)v];
+
+  {
+    std::vector<int> fill(b.vertexFaceOffset.data(), b.vertexFaceOffset.data() + nV);
+    for (int f = 0; f < nF; ++f) {
+      for (int k = b.faceOffset[(size_t)f]; k < b.faceOffset[(size_t)f + 1]; ++k) {
+        b.vertexFaces[(size_t)fill[(size_t)b.corners[(size_t)k].vertex_index]++] = f;
+      }
+    }
+  }
+
+  return true;
+}
+
+static void gatherChunk(StreamingBake& b, int chunk, ChunkMesh& out) {
+  const int first = b.chunkFaceOffset[(size_t)chunk];
+  const int last = b.chunkFaceOffset[(size_t)chunk + 1];
+  out.faces.assign(b.chunkFaces.data() + first, b.chunkFaces.data() + last);
+  out.ownFaces = last - first;
+
+  // Halo: faces of other chunks around the vertices the chunk shares with them
+  std::vector<int> halo;
+  for (int i = 0; i < out.ownFaces; ++i) {
+    const size_t f = (size_t)out.faces[(size_t)i];
+    for (int k = b.faceOffset[f]; k < b.faceOffset[f + 1]; ++k) {
+      const size_t v = (size_t)b.corners[(size_t)k].vertex_index;
+      if (b.vertexChunk[v] != -2) continue;
+      for (int j = b.vertexFaceOffset[v]; j < b.vertexFaceOffset[v + 1]; ++j) {
+        const int g = b.vertexFaces[(size_t)j];
+        if (b.faceChunk[(size_t)g] != chunk) halo.push_back(g);
+      }
+    }
+  }
+  std::sort(halo.begin(), halo.end());
+  halo.erase(std::unique(halo.begin(), halo.end()), halo.end());
+  out.faces.insert(out.faces.end(), halo.begin(), halo.end());
+
+  // Collect each vertex and texcoord once, then number them in ascending order
+  out.verts.clear();
+  out.texcoords.clear();
+  size_t cornerCount = 0;
+  for (int f : out.faces) {
+    for (int k = b.faceOffset[(size_t)f]; k < b.faceOffset[(size_t)f + 1]; ++k) {
+      const tinyobj::index_t& idx = b.corners[(size_t)k];
+      int& v = b.vertexLocal[(size_t)idx.vertex_index];
+      if (v < 0) {
+        v = 0;
+        out.verts.push_back(idx.vertex_index);
+      }
+      if (idx.texcoord_index < 0) continue;
+      int& vt = b.texcoordLocal[(size_t)idx.texcoord_index];
+      if (vt < 0) {
+        vt = 0;
+        out.texcoords.push_back(idx.texcoord_index);
+      }
+    }
+    cornerCount += (size_t)(b.faceOffset[(size_t)f + 1] - b.faceOffset[(size_t)f]);
+  }
+  std::sort(out.verts.begin(), out.verts.end());
+  std::sort(out.texcoords.begin(), out.texcoords.end());
+
+  ObjPolys& m = out.mesh;
+  m.attrib = tinyobj::attrib_t();
+  m.attrib.vertices.resize(out.verts.size() * 3);
+  for (size_t i = 0; i < out.verts.size(); ++i) {
+    b.vertexLocal[(size_t)out.verts[i]] = (int)i;
+    std::memcpy(&m.attrib.vertices[i * 3], &b.positions[(size_t)out.verts[i] * 3], 3 * sizeof(tinyobj::real_t));
+  }
+  m.attrib.texcoords.resize(out.texcoords.size() * 2);
+  for (size_t i = 0; i < out.texcoords.size(); ++i) {
+    b.texcoordLocal[(size_t)out.texcoords[i]] = (int)i;
+    std::memcpy(&m.attrib.texcoords[i * 2], &b.texcoords[(size_t)out.texcoords[i] * 2], 2 * sizeof(tinyobj::real_t));
+  }
+
+  m.polys.offset.assign(1, 0);
+  m.polys.offset.reserve(out.faces.size() + 1);
+  m.polys.items.clear();
+  m.polys.items.reserve(cornerCount);
+  for (int f : out.faces) {
+    for (int k = b.faceOffset[(size_t)f]; k < b.faceOffset[(size_t)f + 1]; ++k) {
+      const tinyobj::index_t& idx = b.corners[(size_t)k];
+      tinyobj::index_t local{-1, -1, -1};
+      local.vertex_index = b.vertexLocal[(size_t)idx.vertex_index];
+      local.texcoord_index = idx.texcoord_index >= 0 ? b.texcoordLocal[(size_t)idx.texcoord_index] : -1;
+      m.polys.items.push_back(local);
+    }
+    m.polys.offset.push_back((int)m.polys.items.size());
+  }
+
+  m.nV_in = (int)out.verts.size();
+  m.nVT_in = (int)out.texcoords.size();
+
+  for (int v : out.verts) b.vertexLocal[(size_t)v] = -1;
+  for (int vt : out.texcoords) b.texcoordLocal[(size_t)vt] = -1;
+}
+
+static void prepareChunk(StreamingBake& b, int chunk, int threads, ChunkStages& st) {
+  if (st.chunk == chunk) return;
+
+  gatherChunk(b, chunk, st.cm);
+  st.tris = triangulate(st.cm.mesh);
+  st.topo = buildTopology(st.cm.mesh, st.tris);
+  computeTriGeometry(st.cm.mesh, st.tris, st.geom, threads);
+  st.chunk = chunk;
+}
+
+static int findRoot(int* parent, int x) {
+  while (parent[x] != x) {
+    parent[x] = parent[parent[x]];
+    x = parent[x];
+  }
+  return x;
+}
+
+// UV islands over the whole mesh and the axis each one picks, like computeFaceIslands and scoreIslandsAxis.
+// Chunks find the UV neighbors of their own faces, which the halo makes complete, and store the geometry of
+// their triangles. The sums then run over faces in ascending order like in memory.
+// Chunks are visited last to first, which leaves the first one prepared for the bake.
+static bool computeFaceAxes(StreamingBake& b, int threads, ChunkStages& st) {
+  const int nF = b.faces();
+  const size_t nTris = b.corners.size() - (size_t)nF * 2;
+
+  SpillArray<int> parent;
+  SpillArray<TriScore> triScore;
+  if (!b.create(parent) || !parent.resize((size_t)nF)) return spillFailed();
+  if (!b.create(triScore) || !triScore.resize(nTris)) return spillFailed();
+  for (int f = 0; f < nF; ++f) parent[(size_t)f] = f;
+
+  const ChunkMesh& cm = st.cm;
+  const TriGeometry& geom = st.geom;
+
+  for (int chunk = (int)b.chunkFaceOffset.size() - 2; chunk >= 0; --chunk) {
+    prepareChunk(b, chunk, threads, st);
+    const Csr<int> neighbors = buildUvNeighbors(cm.mesh, st.tris, st.topo);
+
+    int localTri = 0;
+    for (int p = 0; p < cm.ownFaces; ++p) {
+      const int f = cm.faces[(size_t)p];
+      for (int nb : neighbors.row(p)) {
+        const int ra = findRoot(parent.data(), f);
+        const int rb = findRoot(parent.data(), cm.faces[(size_t)nb]);
+        if (ra != rb) parent[(size_t)std::max(ra, rb)] = std::min(ra, rb);
+      }
+
+      const size_t firstTri = (size_t)b.faceOffset[(size_t)f] - (size_t)f * 2;
+      for (int i = 0; i < cm.mesh.polys.rowSize(p) - 2; ++i, ++localTri) {
+        TriScore& s = triScore[firstTri + (size_t)i];
+        const size_t t = (size_t)localTri;
+        s = TriScore{{geom.ux[t], geom.uy[t], geom.uz[t]}, {geom.vx[t], geom.vy[t], geom.vz[t]}, geom.area[t]};
+      }
+    }
+  }
+
+  // Parents never point to a later face, so one ascending pass numbers the islands in the same order as
+  // computeFaceIslands. The parent array is reused for the island ids, stored as -1 - id.
+  SpillArray<IslandSum> sums;
+  if (!b.create(sums)) return spillFailed();
+  for (int f = 0; f < nF; ++f) {
+    const int p = parent[(size_t)f];
+    if (p == f) {
+      const IslandSum zero{};
+      if (!sums.append(&zero, 1)) return spillFailed();
+      parent[(size_t)f] = -(int)sums.size();
+    } else {
+      parent[(size_t)f] = parent[(size_t)p];
+    }
+  }
+
+  auto islandOf = [&](int f) { return (size_t)(-parent[(size_t)f] - 1); };
+
+  for (int f = 0; f < nF; ++f) {
+    IslandSum& s = sums[islandOf(f)];
+    const size_t firstTri = (size_t)b.faceOffset[(size_t)f] - (size_t)f * 2;
+    const size_t lastTri = (size_t)b.faceOffset[(size_t)f + 1] - (size_t)(f + 1) * 2;
+
+    for (size_t ti = firstTri; ti < lastTri; ++ti) {
+      const TriScore& t = triScore[ti];
+      if (2.0 * t.area < 1e-8) continue;
+
+      const Eigen::Vector3d dPdu(t.dPdu[0], t.dPdu[1], t.dPdu[2]);
+      const Eigen::Vector3d dPdv(t.dPdv[0], t.dPdv[1], t.dPdv[2]);
+      const double ulen = dPdu.norm();
+      const double vlen = dPdv.norm();
+
+      if (ulen > 1e-8) {
+        for (int a = 0; a < 3; ++a) s.sumU[a] += dPdu[a];
+        s.sumUlen += ulen;
+      }
+      if (vlen > 1e-8) {
+        for (int a = 0; a < 3; ++a) s.sumV[a] += dPdv[a];
+        s.sumVlen += vlen;
+      }
+    }
+  }
+
+  if (!b.create(b.faceAxis) || !b.faceAxis.resize((size_t)nF)) return spillFailed();
+  for (int f = 0; f < nF; ++f) {
+    const IslandSum& s = sums[islandOf(f)];
+    b.faceAxis[(size_t)f] = (s.sumUlen > s.sumVlen) ? 'U' : 'V';
+  }
+
+  return true;
+}
+
+// Runs the pipeline on one chunk and appends the output of its own faces. Vertices are emitted in the
+// order buildSplitMesh created them, so a single chunk matches the in-memory bake.
+static bool bakeChunk(
+    StreamingBake& b,
+    int chunk,
+    const FlowfieldSettings& settings,
+    int threads,
+    ChunkStages& st,
+    StreamingBakeStats& stats
+) {
+  prepareChunk(b, chunk, threads, st);
+  const ChunkMesh& cm = st.cm;
+  const ObjPolys& m = cm.mesh;
+  const std::vector<Tri>& tris = st.tris;
+  const MeshTopology& topo = st.topo;
+  const TriGeometry& geom = st.geom;
+  stats.haloFaces += cm.faces.size() - (size_t)cm.ownFaces;
+
+  const auto creaseEdge = computeCreaseEdges(topo, geom, settings.creaseThresholdAngle, threads);
+  const SplitMesh split = buildSplitMesh(m, tris, topo, creaseEdge, settings.creaseThresholdAngle, threads);
+  const int nSplit = (int)split.outPos.size();
+  const Csr<int> adj = buildAdjacencyVec(tris, topo, split.cornerOut, nSplit);
+
+  // The island axes are already decided, so every polygon points at one of two stand-in islands
+  std::vector<int> polyIsland;
+  std::vector<UvIsland> islands;
+  if (settings.axis == 'A') {
+    islands.resize(2);
+    islands[0].chosenAxis = 'U';
+    islands[1].chosenAxis = 'V';
+    polyIsland.resize(cm.faces.size());
+    for (size_t p = 0; p < cm.faces.size(); ++p) polyIsland[p] = b.faceAxis[(size_t)cm.faces[p]] == 'U' ? 0 : 1;
+  }
+
+  std::vector<Eigen::Vector3d> vNormal, vTangent;
+  std::vector<double> vWeight;
+  accumulateNormalsAndTangents(
+      tris,
+      polyIsland,
+      islands,
+      settings.axis,
+      geom,
+      split.cornerOut,
+      nSplit,
+      vNormal,
+      vTangent,
+      vWeight,
+      threads,
+      settings.singlePrecision
+  );
+  const std::vector<Eigen::Vector3d> flow = buildFlowFromAccum(vNormal, vTangent, vWeight, adj, threads);
+
+  // Connected components, each of which buildFlowFromAccum oriented on its own
+  std::vector<int> comp((size_t)nSplit, -1);
+  int compCount = 0;
+  {
+    std::vector<int> stack;
+    for (int s = 0; s < nSplit; ++s) {
+      if (comp[(size_t)s] >= 0) continue;
+      comp[(size_t)s] = compCount;
+      stack.push_back(s);
+      while (!stack.empty()) {
+        const int v = stack.back();
+        stack.pop_back();
+        for (int nb : adj.row(v)) {
+          if (comp[(size_t)nb] < 0) {
+            comp[(size_t)nb] = compCount;
+            stack.push_back(nb);
+          }
+        }
+      }
+      ++compCount;
+    }
+  }
+
+  // Only vertices of the chunk's own faces are emitted, the halo's belong to other chunks
+  const int ownCorners = m.polys.offset[(size_t)cm.ownFaces];
+  std::vector<int> outIndex((size_t)nSplit, -1);
+  for (int k = 0; k < ownCorners; ++k) outIndex[(size_t)split.cornerOut[(size_t)k]] = 0;
+
+  const size_t base = b.outVerts.size() / 6;
+  std::vector<float> verts;
+  std::vector<int> comps;
+  for (int s = 0; s < nSplit; ++s) {
+    if (outIndex[(size_t)s] < 0) continue;
+    outIndex[(size_t)s] = (int)comps.size();
+
+    const Eigen::Vector3d& p = split.outPos[(size_t)s];
+    const Eigen::Vector3d& t = flow[(size_t)s];
+    verts.insert(verts.end(), {(float)p.x(), (float)p.y(), (float)p.z(), (float)t.x(), (float)t.y(), (float)t.z()});
+    comps.push_back(b.compCount + comp[(size_t)s]);
+  }
+  if (base + comps.size() > (size_t)UINT32_MAX) {
+    std::cerr << "Flowfield output too large for 32-bit indices\n";
+    return false;
+  }
+
+  auto globalIndex = [&](int s) { return (unsigned int)(base + (size_t)outIndex[(size_t)s]); };
+
+  std::vector<unsigned int> indices;
+  indices.reserve((size_t)(ownCorners - 2 * cm.ownFaces) * 3);
+  for (int p = 0; p < cm.ownFaces; ++p) {
+    const int* face = split.cornerOut.data() + m.polys.offset[(size_t)p];
+    for (int i = 1; i < m.polys.rowSize(p) - 1; ++i) {
+      indices.push_back(globalIndex(face[0]));
+      indices.push_back(globalIndex(face[i]));
+      indices.push_back(globalIndex(face[i + 1]));
+    }
+  }
+
+  // Emitted vertices whose input vertex other chunks emit as well
+  std::vector<BorderVertex> border;
+  std::vector<uint8_t> recorded((size_t)nSplit, 0);
+  for (int k = 0; k < ownCorners; ++k) {
+    const int s = split.cornerOut[(size_t)k];
+    const tinyobj::index_t& idx = m.polys.items[(size_t)k];
+    const int v = cm.verts[(size_t)idx.vertex_index];
+    if (recorded[(size_t)s] || b.vertexChunk[(size_t)v] != -2) continue;
+    recorded[(size_t)s] = 1;
+
+    const int vt = idx.texcoord_index >= 0 ? cm.texcoords[(size_t)idx.texcoord_index] : -1;
+    border.push_back(BorderVertex{v, vt, chunk, globalIndex(s)});
+  }
+
+  if (!b.outVerts.append(verts.data(), verts.size()) || !b.outIndices.append(indices.data(), indices.size())
+      || !b.outComp.append(comps.data(), comps.size()) || !b.border.append(border.data(), border.size()))
+    return spillFailed();
+
+  b.compCount += compCount;
+  stats.borderVertices += border.size();
+  return true;
+}
+
+static int findOrientation(int* parent, uint8_t* flip, int x, uint8_t& parity) {
+  int root = x;
+  uint8_t p = 0;
+  while (parent[root] != root) {
+    p ^= flip[root];
+    root = parent[root];
+  }
+
+  // Point the whole path at the root, flip becomes the parity relative to it
+  uint8_t rest = p;
+  while (parent[x] != x) {
+    const int next = parent[x];
+    const uint8_t f = flip[x];
+    parent[x] = root;
+    flip[x] = rest;
+    rest ^= f;
+    x = next;
+  }
+
+  parity = p;
+  return root;
+}
+
+// Every chunk orients its components independently. Copies of the same input vertex and texcoord in
+// different chunks tie their components together, with the parity given by whether their flows agree, and
+// components are then flipped to agree with the earliest chunk they are connected to.
+static bool orientAcrossChunks(StreamingBake& b, int threads) {
+  const int nComp = b.compCount;
+  if (b.border.size() == 0 || nComp == 0) return true;
+
+  SpillArray<int> parent;
+  SpillArray<uint8_t> flip;
+  if (!b.create(parent) || !parent.resize((size_t)nComp)) return spillFailed();
+  if (!b.create(flip) || !flip.resize((size_t)nComp)) return spillFailed();
+  for (int c = 0; c < nComp; ++c) {
+    parent[(size_t)c] = c;
+    flip[(size_t)c] = 0;
+  }
+
+  BorderVertex* border = b.border.data();
+  const size_t nBorder = b.border.size();
+  std::sort(border, border + nBorder, [](const BorderVertex& x, const BorderVertex& y) {
+    if (x.v != y.v) return x.v < y.v;
+    if (x.vt != y.vt) return x.vt < y.vt;
+    return x.out < y.out;
+  });
+
+  auto flowOf = [&](unsigned int out) {
+    const float* f = b.outVerts.data() + (size_t)out * 6 + 3;
+    return Eigen::Vector3d(f[0], f[1], f[2]);
+  };
+
+  for (size_t first = 0; first < nBorder;) {
+    size_t last = first + 1;
+    while (last < nBorder && border[last].v == border[first].v && border[last].vt == border[first].vt) ++last;
+
+    // Output order follows chunk order, so every copy is matched against the best one of an earlier chunk
+    for (size_t i = first + 1; i < last; ++i) {
+      const Eigen::Vector3d fi = flowOf(border[i].out);
+      double best = 0.0;
+      size_t partner = i;
+      for (size_t j = first; j < i; ++j) {
+        if (border[j].chunk == border[i].chunk) continue;
+        const double d = fi.dot(flowOf(border[j].out));
+        if (std::abs(d) > std::abs(best)) {
+          best = d;
+          partner = j;
+        }
+      }
+      if (partner == i || std::abs(best) < minOrientationDot) continue;
+
+      uint8_t pa = 0, pb = 0;
+      const int ra = findOrientation(parent.data(), flip.data(), b.outComp[border[partner].out], pa);
+      const int rb = findOrientation(parent.data(), flip.data(), b.outComp[border[i].out], pb);
+      if (ra == rb) continue;
+
+      parent[(size_t)std::max(ra, rb)] = std::min(ra, rb);
+      flip[(size_t)std::max(ra, rb)] = pa ^ pb ^ (best < 0.0 ? 1 : 0);
+    }
+
+    first = last;
+  }
+
+  for (int c = 0; c < nComp; ++c) {
+    uint8_t parity = 0;
+    findOrientation(parent.data(), flip.data(), c, parity);
+  }
+
+  const size_t nOut = b.outComp.size();
+  parallelFor(nOut, threads, [&](size_t begin, size_t end, int) {
+    for (size_t i = begin; i < end; ++i) {
+      if (!flip[(size_t)b.outComp[i]]) continue;
+      float* f = b.outVerts.data() + i * 6 + 3;
+      f[0] = -f[0];
+      f[1] = -f[1];
+      f[2] = -f[2];
+    }
+  });
+
+  return true;
+}
+
+bool BakeFlowfieldStreaming(
+    const std::string& objPath,
+    uint64_t objHash,
+    const FlowfieldSettings& settings,
+    const StreamingBakeOptions& options,
+    StreamingBakeStats* stats,
+    const std::string& cacheDir
+) {
+  TRACE_ZONE("BakeFlowfieldStreaming");
+  namespace fs = std::filesystem;
+
+  const int threads = resolveThreadCount(settings.threads);
+  StreamingBakeStats localStats;
+  StreamingBakeStats& st = stats ? *stats : localStats;
+  st = StreamingBakeStats();
+
+  std::error_code ec;
+  const fs::path spillDir = options.spillDir.empty() ? fs::temp_directory_path(ec) : fs::path(options.spillDir);
+  if (ec || !fs::is_directory(spillDir, ec)) {
+    std::cerr << "Spill directory does not exist: " << spillDir.string() << "\n";
+    return false;
+  }
+
+  char name[48];
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  std::snprintf(name, sizeof(name), "noice-spill-%016llx", (unsigned long long)(objHash ^ (uint64_t)now));
+
+  StreamingBake b;
+  b.spillPrefix = (spillDir / name).string();
+
+  const size_t memoryLimit = std::max(options.memoryLimit, (size_t)1 << 20);
+  if (!parseInput(objPath, memoryLimit / 4, threads, b)) return false;
+  if (!partitionFaces(b, memoryLimit / bytesPerTriangle, threads)) return false;
+
+  const int chunkCount = (int)b.chunkFaceOffset.size() - 1;
+  st.chunks = chunkCount;
+
+  ChunkStages stages;
+  if (settings.axis == 'A' && !computeFaceAxes(b, threads, stages)) return false;
+
+  if (!b.create(b.outVerts) || !b.create(b.outIndices) || !b.create(b.outComp) || !b.create(b.border)) {
+    std::cerr << "Failed to create spill files: " << b.spillPrefix << "\n";
+    return false;
+  }
+
+  for (int chunk = 0; chunk < chunkCount; ++chunk) {
+    if (!bakeChunk(b, chunk, settings, threads, stages, st)) return false;
+  }
+
+  if (!orientAcrossChunks(b, threads)) return false;
+
+  st.spillBytes = b.spillBytes();
+
+  return StoreFlowfieldCache(
+      objHash,
+      settings,
+      FlowfieldCacheLayout::Streamed,
+      b.outVerts.data(),
+      b.outVerts.size(),
+      b.outIndices.data(),
+      b.outIndices.size(),
+      nullptr,
+      0,
+      cacheDir
+  );
+}
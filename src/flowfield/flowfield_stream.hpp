@@ -0,0 +1,44 @@
+#pragma once
+
+#include "flowfield.hpp"
+#include "flowfield_cache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Out-of-core bake for OBJ files whose pipeline data does not fit in memory.
+//
+// The faces are split into spatially compact chunks of bounded size. Each chunk runs through the regular
+// pipeline together with a halo of the faces that share a vertex with it, so the normals, tangents, crease
+// splits and UV seams of its own vertices see their full neighborhood. Mesh-wide data (parsed attributes,
+// the partition, vertex to face incidence, UV islands) and the output live in spill files that are mapped
+// instead of held in memory, and every chunk's output is appended as soon as it is baked.
+//
+// Compared to ComputeUvFlowfieldFromOBJ, triangles come out grouped by chunk, vertices on chunk borders are
+// duplicated, and vertices without a usable tangent only borrow one from across a chunk border within the
+// halo. Flow orientation is reconciled across chunks. A mesh that fits in one chunk bakes identically.
+// No levels of detail are built and neither the input nor the draw order is reordered.
+
+struct StreamingBakeOptions {
+  size_t memoryLimit = (size_t)1 << 30; // in-memory working set to aim for in bytes, spill mappings excluded
+  std::string spillDir;                 // directory for spill files, empty for the system temp directory
+};
+
+struct StreamingBakeStats {
+  int chunks = 0;
+  size_t haloFaces = 0;      // faces baked again as part of a neighboring chunk's halo
+  size_t borderVertices = 0; // output vertices on chunk borders
+  size_t spillBytes = 0;     // mapped size of the mesh-wide spill files
+};
+
+// Bakes objPath, whose contents hash to objHash (HashFileContents), into the streamed flowfield cache entry for
+// settings. Load the result with LoadFlowfieldCache and FlowfieldCacheLayout::Streamed.
+bool BakeFlowfieldStreaming(
+    const std::string& objPath,
+    uint64_t objHash,
+    const FlowfieldSettings& settings,
+    const StreamingBakeOptions& options = {},
+    StreamingBakeStats* stats = nullptr,
+    const std::string& cacheDir = defaultFlowfieldCacheDir
+);
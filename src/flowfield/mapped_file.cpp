@@ -0,0 +1,232 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+// Smallest mapping a SpillFile grows to, so small arrays do not remap on every append
+static constexpr size_t spillMinCapacity = 1 << 20;
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    Close();
+    data = other.data;
+    size = other.size;
+    opened = other.opened;
+#ifdef _WIN32
+    fileHandle = other.fileHandle;
+    mapHandle = other.mapHandle;
+    other.fileHandle = nullptr;
+    other.mapHandle = nullptr;
+#endif
+    other.data = nullptr;
+    other.size = 0;
+    other.opened = false;
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+
+  HANDLE file = CreateFileA(
+      path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+  );
+  if (file == INVALID_HANDLE_VALUE) return false;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    return false;
+  }
+
+  if (fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    opened = true;
+    return true;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping) {
+    CloseHandle(file);
+    return false;
+  }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  fileHandle = file;
+  mapHandle = mapping;
+  data = (const unsigned char*)view;
+  size = (size_t)fileSize.QuadPart;
+  opened = true;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data) UnmapViewOfFile(data);
+  if (mapHandle) CloseHandle((HANDLE)mapHandle);
+  if (fileHandle) CloseHandle((HANDLE)fileHandle);
+  fileHandle = nullptr;
+  mapHandle = nullptr;
+  data = nullptr;
+  size = 0;
+  opened = false;
+}
+
+bool SpillFile::Create(const std::string& path) {
+  Close();
+
+  HANDLE file = CreateFileA(
+      path.c_str(),
+      GENERIC_READ | GENERIC_WRITE,
+      0,
+      nullptr,
+      CREATE_NEW,
+      FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+      nullptr
+  );
+  if (file == INVALID_HANDLE_VALUE) return false;
+
+  fileHandle = file;
+  return true;
+}
+
+bool SpillFile::Reserve(size_t bytes) {
+  if (!fileHandle) return false;
+  if (bytes <= capacity) return true;
+
+  const size_t newCapacity = std::max({bytes, capacity * 2, spillMinCapacity});
+
+  if (data) UnmapViewOfFile(data);
+  if (mapHandle) CloseHandle((HANDLE)mapHandle);
+  data = nullptr;
+  mapHandle = nullptr;
+  capacity = 0;
+
+  // Mapping past the end extends the file
+  const uint64_t size = newCapacity;
+  HANDLE mapping = CreateFileMappingA(
+      (HANDLE)fileHandle, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xffffffffu), nullptr
+  );
+  if (!mapping) return false;
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    return false;
+  }
+
+  mapHandle = mapping;
+  data = (unsigned char*)view;
+  capacity = newCapacity;
+  return true;
+}
+
+void SpillFile::Close() {
+  if (data) UnmapViewOfFile(data);
+  if (mapHandle) CloseHandle((HANDLE)mapHandle);
+  if (fileHandle) CloseHandle((HANDLE)fileHandle);
+  fileHandle = nullptr;
+  mapHandle = nullptr;
+  data = nullptr;
+  capacity = 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  if (st.st_size == 0) {
+    close(fd);
+    opened = true;
+    return true;
+  }
+
+  void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (view == MAP_FAILED) return false;
+
+  data = (const unsigned char*)view;
+  size = (size_t)st.st_size;
+  opened = true;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data) munmap((void*)data, size);
+  data = nullptr;
+  size = 0;
+  opened = false;
+}
+
+bool SpillFile::Create(const std::string& path) {
+  Close();
+
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) return false;
+
+  // Only the descriptor keeps the file alive from here on
+  unlink(path.c_str());
+  return true;
+}
+
+bool SpillFile::Reserve(size_t bytes) {
+  if (fd < 0) return false;
+  if (bytes <= capacity) return true;
+
+  const size_t newCapacity = std::max({bytes, capacity * 2, spillMinCapacity});
+  if (ftruncate(fd, (off_t)newCapacity) != 0) return false;
+
+  if (data) munmap(data, capacity);
+  data = nullptr;
+  capacity = 0;
+
+  void* view = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (view == MAP_FAILED) return false;
+
+  data = (unsigned char*)view;
+  capacity = newCapacity;
+  return true;
+}
+
+void SpillFile::Close() {
+  if (data) munmap(data, capacity);
+  if (fd >= 0) close(fd);
+  fd = -1;
+  data = nullptr;
+  capacity = 0;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+struct MappedFile {
+  const unsigned char* data = nullptr;
+  size_t size = 0;
+
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  bool Open(const std::string& path);
+  void Close();
+
+  bool IsOpen() const { return data != nullptr || opened; }
+
+private:
+  bool opened = false; // empty files are open without a mapping
+#ifdef _WIN32
+  void* fileHandle = nullptr;
+  void* mapHandle = nullptr;
+#endif
+};
+
+// Read-write mapping of an anonymous scratch file that grows on demand. The file is deleted as soon as it is
+// created and disappears with the mapping, and since its pages are backed by the file rather than by swap,
+// the OS can write them back and drop them under memory pressure.
+struct SpillFile {
+  unsigned char* data = nullptr;
+  size_t capacity = 0;
+
+  SpillFile() = default;
+  ~SpillFile() { Close(); }
+  SpillFile(const SpillFile&) = delete;
+  SpillFile& operator=(const SpillFile&) = delete;
+
+  // path only names the file while it is being created, it must not exist yet
+  bool Create(const std::string& path);
+  // Grows the mapping to at least bytes, data may move
+  bool Reserve(size_t bytes);
+  void Close();
+
+private:
+#ifdef _WIN32
+  void* fileHandle = nullptr;
+  void* mapHandle = nullptr;
+#else
+  int fd = -1;
+#endif
+};
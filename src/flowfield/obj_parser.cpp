@@ -0,0 +1,332 @@
+#include "obj_parser.hpp"
+
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace flowfield::detail {
+
+  static constexpr size_t minChunkBytes = 256 * 1024;
+
+  struct ObjChunk : ObjBlock {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    // Corners using relative indices. They are resolved against the chunk's own counts while parsing
+    // and rebased by the number of elements in preceding chunks when merging.
+    std::vector<uint32_t> relV;
+    std::vector<uint32_t> relVT;
+
+    bool ok = true;
+  };
+
+  static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  static inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+  }
+
+  static inline const char* skipLine(const char* p, const char* end) {
+    const void* nl = std::memchr(p, '\n', (size_t)(end - p));
+    return nl ? (const char*)nl + 1 : end;
+  }
+
+  static inline const char* parseFloat(const char* p, const char* end, tinyobj::real_t& out) {
+    p = skipBlanks(p, end);
+    if (p < end && *p == '+') ++p;
+    auto res = std::from_chars(p, end, out);
+    return (res.ec == std::errc()) ? res.ptr : nullptr;
+  }
+
+  static inline const char* parseInt(const char* p, const char* end, int& out) {
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+    if (p >= end || *p < '0' || *p > '9') return nullptr;
+
+    int64_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+      v = v * 10 + (*p++ - '0');
+      if (v > INT32_MAX) return nullptr;
+    }
+    out = (int)(neg ? -v : v);
+    return p;
+  }
+
+  // Resolves a 1-based or negative OBJ index against the number of elements seen so far in the chunk.
+  static inline int resolveIndex(int idx, int countSoFar, bool& relative) {
+    relative = idx < 0;
+    return relative ? countSoFar + idx : idx - 1;
+  }
+
+  static const char* parseFace(const char* p, const char* end, ObjChunk& c) {
+    const int nV = (int)(c.positions.size() / 3);
+    const int nVT = (int)(c.texcoords.size() / 2);
+    const size_t first = c.corners.size();
+
+    while (true) {
+      p = skipBlanks(p, end);
+      if (p >= end || *p == '\n' || *p == '#') break;
+
+      tinyobj::index_t idx{-1, -1, -1};
+      int v = 0;
+      p = parseInt(p, end, v);
+      if (!p || v == 0) return nullptr;
+
+      bool rel = false;
+      idx.vertex_index = resolveIndex(v, nV, rel);
+      if (rel) c.relV.push_back((uint32_t)c.corners.size());
+
+      if (p < end && *p == '/') {
+        ++p;
+        if (p < end && *p != '/' && !isBlank(*p) && *p != '\n') {
+          int vt = 0;
+          p = parseInt(p, end, vt);
+          if (!p || vt == 0) return nullptr;
+          idx.texcoord_index = resolveIndex(vt, nVT, rel);
+          if (rel) c.relVT.push_back((uint32_t)c.corners.size());
+        }
+        if (p < end && *p == '/') {
+          ++p;
+          int vn = 0;
+          if (p < end && *p != '\n' && !isBlank(*p) && !(p = parseInt(p, end, vn))) return nullptr;
+        }
+      }
+
+      c.corners.push_back(idx);
+    }
+
+    const size_t count = c.corners.size() - first;
+    if (count < 3) {
+      while (!c.relV.empty() && c.relV.back() >= first) c.relV.pop_back();
+      while (!c.relVT.empty() && c.relVT.back() >= first) c.relVT.pop_back();
+      c.corners.resize(first);
+    } else {
+      c.faceSize.push_back((int)count);
+    }
+    return p;
+  }
+
+  static void parseChunk(ObjChunk& c) {
+    const char* p = c.begin;
+    const char* end = c.end;
+
+    // Rough guess from typical line lengths, avoids most regrowth
+    const size_t bytes = (size_t)(end - p);
+    c.positions.reserve(bytes / 40 * 3);
+    c.texcoords.reserve(bytes / 40 * 2);
+    c.corners.reserve(bytes / 20);
+    c.faceSize.reserve(bytes / 60);
+
+    while (p < end) {
+      p = skipBlanks(p, end);
+      if (p >= end) break;
+
+      if (p[0] == 'v' && p + 1 < end && isBlank(p[1])) {
+        tinyobj::real_t xyz[3];
+        p += 1;
+        for (int k = 0; k < 3 && p; ++k) p = parseFloat(p, end, xyz[k]);
+        if (!p) {
+          c.ok = false;
+          return;
+        }
+        c.positions.insert(c.positions.end(), xyz, xyz + 3);
+      } else if (p[0] == 'v' && p + 2 < end && p[1] == 't' && isBlank(p[2])) {
+        tinyobj::real_t uv[2] = {0, 0};
+        p = parseFloat(p + 2, end, uv[0]);
+        if (!p) {
+          c.ok = false;
+          return;
+        }
+        const char* q = skipBlanks(p, end);
+        if (q < end && *q != '\n' && *q != '#') p = parseFloat(q, end, uv[1]);
+        if (!p) {
+          c.ok = false;
+          return;
+        }
+        c.texcoords.insert(c.texcoords.end(), uv, uv + 2);
+      } else if (p[0] == 'f' && p + 1 < end && isBlank(p[1])) {
+        p = parseFace(p + 1, end, c);
+        if (!p) {
+          c.ok = false;
+          return;
+        }
+      }
+
+      p = skipLine(p, end);
+    }
+  }
+
+  // Splits [data, end) into line-aligned chunks, a few per thread to even out differing line mixes
+  static std::vector<ObjChunk> splitChunks(const char* data, const char* end, int threads) {
+    const size_t size = (size_t)(end - data);
+    const int chunkTarget = parallelBlockCount(size, threads, minChunkBytes) * 4;
+    std::vector<ObjChunk> chunks;
+    chunks.reserve((size_t)chunkTarget);
+
+    const char* cursor = data;
+    for (int i = 0; i < chunkTarget && cursor < end; ++i) {
+      const char* chunkEnd = data + size * (size_t)(i + 1) / (size_t)chunkTarget;
+      if (chunkEnd < cursor) chunkEnd = cursor;
+      if (i + 1 < chunkTarget) chunkEnd = skipLine(chunkEnd, end);
+      else chunkEnd = end;
+      if (chunkEnd == cursor) continue;
+
+      ObjChunk c;
+      c.begin = cursor;
+      c.end = chunkEnd;
+      chunks.push_back(std::move(c));
+      cursor = chunkEnd;
+    }
+    return chunks;
+  }
+
+  bool parseObjFile(
+      const std::string& path,
+      std::vector<tinyobj::real_t>& positions,
+      std::vector<tinyobj::real_t>& texcoords,
+      std::vector<int>& faceOffset,
+      std::vector<tinyobj::index_t>& corners,
+      int threads
+  ) {
+    MappedFile file;
+    if (!file.Open(path)) {
+      std::cerr << "Failed to read OBJ: " << path << "\n";
+      return false;
+    }
+
+    const char* data = (const char*)file.data;
+    const size_t size = file.size;
+
+    std::vector<ObjChunk> chunks = splitChunks(data, data + size, threads);
+    parallelForEach(chunks.size(), threads, [&](size_t i) { parseChunk(chunks[i]); });
+
+    // Element offsets of every chunk in the merged arrays
+    const size_t nChunks = chunks.size();
+    std::vector<size_t> vBase(nChunks + 1, 0), vtBase(nChunks + 1, 0), cBase(nChunks + 1, 0), fBase(nChunks + 1, 0);
+    for (size_t i = 0; i < nChunks; ++i) {
+      const ObjChunk& c = chunks[i];
+      if (!c.ok) {
+        std::cerr << "Malformed OBJ: " << path << "\n";
+        return false;
+      }
+      vBase[i + 1] = vBase[i] + c.positions.size() / 3;
+      vtBase[i + 1] = vtBase[i] + c.texcoords.size() / 2;
+      cBase[i + 1] = cBase[i] + c.corners.size();
+      fBase[i + 1] = fBase[i] + c.faceSize.size();
+    }
+
+    const size_t nV = vBase[nChunks];
+    const size_t nVT = vtBase[nChunks];
+    if (nV > (size_t)INT32_MAX || nVT > (size_t)INT32_MAX || cBase[nChunks] > (size_t)INT32_MAX) {
+      std::cerr << "OBJ too large: " << path << "\n";
+      return false;
+    }
+
+    positions.resize(nV * 3);
+    texcoords.resize(nVT * 2);
+    corners.resize(cBase[nChunks]);
+    faceOffset.resize(fBase[nChunks] + 1);
+    faceOffset[fBase[nChunks]] = (int)cBase[nChunks];
+
+    std::atomic<bool> indicesOk{true};
+
+    parallelForEach(nChunks, threads, [&](size_t i) {
+      ObjChunk& c = chunks[i];
+
+      std::copy(c.positions.begin(), c.positions.end(), positions.begin() + (ptrdiff_t)(vBase[i] * 3));
+      std::copy(c.texcoords.begin(), c.texcoords.end(), texcoords.begin() + (ptrdiff_t)(vtBase[i] * 2));
+
+      for (uint32_t k : c.relV) c.corners[k].vertex_index += (int)vBase[i];
+      for (uint32_t k : c.relVT) c.corners[k].texcoord_index += (int)vtBase[i];
+
+      bool ok = true;
+      tinyobj::index_t* dst = corners.data() + cBase[i];
+      for (size_t k = 0; k < c.corners.size(); ++k) {
+        const tinyobj::index_t& idx = c.corners[k];
+        ok &= idx.vertex_index >= 0 && idx.vertex_index < (int)nV;
+        ok &= idx.texcoord_index >= -1 && idx.texcoord_index < (int)nVT;
+        dst[k] = idx;
+      }
+      if (!ok) indicesOk = false;
+
+      int offset = (int)cBase[i];
+      int* fo = faceOffset.data() + fBase[i];
+      for (size_t f = 0; f < c.faceSize.size(); ++f) {
+        fo[f] = offset;
+        offset += c.faceSize[f];
+      }
+
+      c = ObjChunk();
+    });
+
+    if (!indicesOk) {
+      std::cerr << "OBJ has out of range indices: " << path << "\n";
+      return false;
+    }
+
+    return true;
+  }
+
+  bool streamObjFile(
+      const std::string& path,
+      size_t windowBytes,
+      int threads,
+      const std::function<bool(const ObjBlock&)>& sink
+  ) {
+    MappedFile file;
+    if (!file.Open(path)) {
+      std::cerr << "Failed to read OBJ: " << path << "\n";
+      return false;
+    }
+
+    const char* data = (const char*)file.data;
+    const char* const fileEnd = data + file.size;
+    windowBytes = std::max(windowBytes, minChunkBytes);
+
+    // Elements in all earlier blocks, to resolve relative indices against
+    int64_t nV = 0, nVT = 0, nCorners = 0;
+
+    for (const char* cursor = data; cursor < fileEnd;) {
+      const char* windowEnd = fileEnd;
+      if ((size_t)(fileEnd - cursor) > windowBytes) windowEnd = skipLine(cursor + windowBytes, fileEnd);
+
+      std::vector<ObjChunk> chunks = splitChunks(cursor, windowEnd, threads);
+      parallelForEach(chunks.size(), threads, [&](size_t i) { parseChunk(chunks[i]); });
+
+      for (ObjChunk& c : chunks) {
+        if (!c.ok) {
+          std::cerr << "Malformed OBJ: " << path << "\n";
+          return false;
+        }
+
+        for (uint32_t k : c.relV) c.corners[k].vertex_index += (int)nV;
+        for (uint32_t k : c.relVT) c.corners[k].texcoord_index += (int)nVT;
+
+        nV += (int64_t)(c.positions.size() / 3);
+        nVT += (int64_t)(c.texcoords.size() / 2);
+        nCorners += (int64_t)c.corners.size();
+        if (nV > INT32_MAX || nVT > INT32_MAX || nCorners > INT32_MAX) {
+          std::cerr << "OBJ too large: " << path << "\n";
+          return false;
+        }
+
+        if (!sink(c)) return false;
+        c = ObjChunk();
+      }
+
+      cursor = windowEnd;
+    }
+
+    return true;
+  }
+
+} // namespace flowfield::detail
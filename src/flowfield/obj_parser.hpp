@@ -0,0 +1,46 @@
+#pragma once
+
+#include <tiny_obj_loader.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace flowfield::detail {
+
+  // Memory-mapped OBJ parser. The file is split into line-aligned chunks that are parsed in parallel and
+  // then concatenated, so the result does not depend on the thread count.
+  //
+  // Only what the flowfield needs is read: positions (xyz), texcoords (uv) and faces. Faces are emitted as
+  // offsets into a flat corner array: face f uses corners[faceOffset[f]] .. corners[faceOffset[f + 1] - 1].
+  // Relative (negative) indices are resolved, normal indices are skipped (left at -1) and faces with fewer
+  // than 3 corners are dropped.
+  bool parseObjFile(
+      const std::string& path,
+      std::vector<tinyobj::real_t>& positions,
+      std::vector<tinyobj::real_t>& texcoords,
+      std::vector<int>& faceOffset,
+      std::vector<tinyobj::index_t>& corners,
+      int threads
+  );
+
+  // Elements of a line-aligned piece of an OBJ in file order, with face sizes instead of offsets
+  struct ObjBlock {
+    std::vector<tinyobj::real_t> positions;
+    std::vector<tinyobj::real_t> texcoords;
+    std::vector<int> faceSize;
+    std::vector<tinyobj::index_t> corners;
+  };
+
+  // Streaming variant of parseObjFile for files whose contents do not fit in memory. The file is parsed in
+  // line-aligned windows of about windowBytes and sink receives the blocks in file order, with relative
+  // indices already resolved. Only one window is held in memory at a time. Indices may refer to elements
+  // after the current block, so their range is left for the caller to check. Stops when sink returns false.
+  bool streamObjFile(
+      const std::string& path,
+      size_t windowBytes,
+      int threads,
+      const std::function<bool(const ObjBlock&)>& sink
+  );
+
+} // namespace flowfield::detail
@@ -0,0 +1,122 @@
+#include "parallel.hpp"
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace flowfield::detail {
+
+  namespace {
+
+    // One runOnWorkers call. Tasks are claimed through next, the caller waits until done reaches count.
+    struct PoolJob {
+      const std::function<void(int)>* task = nullptr;
+      int count = 0;
+      std::atomic<int> next{1};
+      std::atomic<int> done{1};
+      std::mutex mutex;
+      std::condition_variable finished;
+
+      // Runs one unclaimed task, false once all are claimed
+      bool runNext() {
+        const int i = next.fetch_add(1);
+        if (i >= count) return false;
+        (*task)(i);
+        if (done.fetch_add(1) + 1 == count) {
+          std::lock_guard<std::mutex> lock(mutex);
+          finished.notify_all();
+        }
+        return true;
+      }
+    };
+
+    class WorkerPool {
+    public:
+      ~WorkerPool() {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads) t.join();
+      }
+
+      void run(int count, const std::function<void(int)>& task) {
+        auto job = std::make_shared<PoolJob>();
+        job->task = &task;
+        job->count = count;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          while ((int)threads.size() < count - 1) threads.emplace_back([this] { workerLoop(); });
+          jobs.push_back(job);
+        }
+        for (int i = 1; i < count; ++i) wake.notify_one();
+
+        task(0);
+        while (job->runNext()) {}
+        retire(job);
+
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished.wait(lock, [&] { return job->done.load() == count; });
+      }
+
+    private:
+      void workerLoop() {
+        trace::SetThreadName("flowfield worker");
+        while (true) {
+          std::shared_ptr<PoolJob> job;
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = jobs.front();
+          }
+          if (!job->runNext()) retire(job);
+        }
+      }
+
+      // Takes a job whose tasks are all claimed off the queue
+      void retire(const std::shared_ptr<PoolJob>& job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find(jobs.begin(), jobs.end(), job);
+        if (it != jobs.end()) jobs.erase(it);
+      }
+
+      std::mutex mutex;
+      std::condition_variable wake;
+      std::deque<std::shared_ptr<PoolJob>> jobs;
+      std::vector<std::thread> threads;
+      bool stopping = false;
+    };
+
+  } // namespace
+
+  void runOnWorkers(int count, const std::function<void(int)>& task) {
+    if (count <= 1) {
+      if (count == 1) task(0);
+      return;
+    }
+    static WorkerPool pool;
+    pool.run(count, task);
+  }
+
+  int resolveThreadCount(int requested) {
+    if (requested > 0) return requested;
+    const unsigned hw = std::thread::hardware_concurrency();
+    return hw > 0 ? (int)hw : 1;
+  }
+
+  int parallelBlockCount(size_t n, int threads, size_t minBlockSize) {
+    if (n == 0) return 1;
+    const size_t blockSize = std::max<size_t>(minBlockSize, 1);
+    const size_t maxBlocks = (n + blockSize - 1) / blockSize;
+    return (int)std::max<size_t>(1, std::min<size_t>((size_t)resolveThreadCount(threads), maxBlocks));
+  }
+
+} // namespace flowfield::detail
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+namespace flowfield::detail {
+
+  // 0 means one thread per hardware thread.
+  int resolveThreadCount(int requested);
+
+  // Runs task(i) for every i in [0, count) on a process-wide pool of worker threads that is created on first use
+  // and grows to the largest count asked for. Task 0 runs on the calling thread, which also picks up tasks no
+  // worker has started, so calls from several threads at once or from inside a task always make progress.
+  void runOnWorkers(int count, const std::function<void(int)>& task);
+
+  // Number of blocks parallelFor splits n items into, so callers can allocate per-block state up front.
+  int parallelBlockCount(size_t n, int threads, size_t minBlockSize = 1024);
+
+  // Runs fn(begin, end, block) over contiguous, balanced blocks of [0, n).
+  // Block 0 runs on the calling thread. Blocks are ordered, so per-block results can be merged deterministically.
+  template<typename Fn>
+  void parallelFor(size_t n, int threads, Fn&& fn, size_t minBlockSize = 1024) {
+    const int blocks = parallelBlockCount(n, threads, minBlockSize);
+    if (blocks <= 1) {
+      if (n > 0) fn((size_t)0, n, 0);
+      return;
+    }
+
+    auto runBlock = [&](int b) {
+      const size_t begin = n * (size_t)b / (size_t)blocks;
+      const size_t end = n * (size_t)(b + 1) / (size_t)blocks;
+      fn(begin, end, b);
+    };
+
+    runOnWorkers(blocks, runBlock);
+  }
+
+  // Runs fn(i) for every i in [0, n), handing out items dynamically. For items of very uneven cost.
+  template<typename Fn>
+  void parallelForEach(size_t n, int threads, Fn&& fn) {
+    const int workerCount = parallelBlockCount(n, threads, 1);
+    if (workerCount <= 1) {
+      for (size_t i = 0; i < n; ++i) fn(i);
+      return;
+    }
+
+    std::atomic<size_t> next{0};
+    runOnWorkers(workerCount, [&](int) {
+      for (size_t i = next.fetch_add(1); i < n; i = next.fetch_add(1)) fn(i);
+    });
+  }
+
+} // namespace flowfield::detail
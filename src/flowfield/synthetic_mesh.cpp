@@ -0,0 +1,313 @@
+#include "synthetic_mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+
+namespace flowfield::detail {
+
+  static void addVertex(ObjPolys& m, double x, double y, double z) {
+    m.attrib.vertices.push_back((tinyobj::real_t)x);
+    m.attrib.vertices.push_back((tinyobj::real_t)y);
+    m.attrib.vertices.push_back((tinyobj::real_t)z);
+  }
+
+  static void addTexcoord(ObjPolys& m, double u, double v) {
+    m.attrib.texcoords.push_back((tinyobj::real_t)u);
+    m.attrib.texcoords.push_back((tinyobj::real_t)v);
+  }
+
+  // Corners as (vertex, texcoord) pairs
+  static void addFace(ObjPolys& m, std::initializer_list<std::pair<int, int>> corners) {
+    for (const auto& [v, vt] : corners) m.polys.items.push_back(tinyobj::index_t{v, -1, vt});
+    m.polys.offset.push_back((int)m.polys.items.size());
+  }
+
+  static void reserve(ObjPolys& m, size_t vertices, size_t texcoords, size_t faces, size_t corners) {
+    m.attrib.vertices.reserve(vertices * 3);
+    m.attrib.texcoords.reserve(texcoords * 2);
+    m.polys.offset.reserve(faces + 1);
+    m.polys.items.reserve(corners);
+  }
+
+  // n x n quads, n a multiple of islands
+  static void makeGrid(ObjPolys& m, size_t triangles, int islands) {
+    const int k = std::max(1, islands);
+    const int n = std::max(k, (int)std::lround(std::sqrt((double)triangles / 2.0) / k) * k);
+    const int s = n / k; // quads per island side
+    const int islandTexcoords = (s + 1) * (s + 1);
+    reserve(m, (size_t)(n + 1) * (n + 1), (size_t)k * k * islandTexcoords, (size_t)n * n, (size_t)n * n * 4);
+
+    for (int j = 0; j <= n; ++j) {
+      for (int i = 0; i <= n; ++i) {
+        const double x = (double)i / n, z = (double)j / n;
+        addVertex(m, x, 0.05 * std::sin(12.0 * x) * std::cos(9.0 * z), z);
+      }
+    }
+
+    for (int island = 0; island < k * k; ++island) {
+      for (int b = 0; b <= s; ++b) {
+        for (int a = 0; a <= s; ++a) {
+          const double u = (double)a / s, v = (double)b / s;
+          if (island % 2) addTexcoord(m, v, u);
+          else addTexcoord(m, u, v);
+        }
+      }
+    }
+
+    for (int j = 0; j < n; ++j) {
+      for (int i = 0; i < n; ++i) {
+        const int v0 = j * (n + 1) + i;
+        const int t0 = ((j / s) * k + i / s) * islandTexcoords + (j % s) * (s + 1) + i % s;
+        addFace(m, {{v0, t0}, {v0 + 1, t0 + 1}, {v0 + n + 2, t0 + s + 2}, {v0 + n + 1, t0 + s + 1}});
+      }
+    }
+  }
+
+  // rings latitude bands of 2 * rings segments, triangle fans at the poles
+  static void makeSphere(ObjPolys& m, size_t triangles) {
+    const int rings = std::max(3, (int)std::lround(std::sqrt((double)triangles / 4.0) + 0.5));
+    const int segs = 2 * rings;
+    const double pi = M_PI;
+    reserve(
+        m,
+        (size_t)(rings - 1) * segs + 2,
+        (size_t)(segs + 1) * (rings + 1),
+        (size_t)segs * rings,
+        (size_t)segs * (rings - 2) * 4 + (size_t)segs * 6
+    );
+
+    addVertex(m, 0.0, 1.0, 0.0);
+    for (int j = 1; j < rings; ++j) {
+      const double theta = pi * j / rings;
+      for (int i = 0; i < segs; ++i) {
+        const double phi = 2.0 * pi * i / segs;
+        addVertex(m, std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+      }
+    }
+    addVertex(m, 0.0, -1.0, 0.0);
+    const int bottom = 1 + (rings - 1) * segs;
+
+    // The pole rows sit at the middle of their segment
+    for (int j = 0; j <= rings; ++j) {
+      const double offset = (j == 0 || j == rings) ? 0.5 : 0.0;
+      for (int i = 0; i <= segs; ++i) addTexcoord(m, (i + offset) / segs, 1.0 - (double)j / rings);
+    }
+
+    auto vertex = [&](int i, int j) { return 1 + (j - 1) * segs + i % segs; };
+    auto texcoord = [&](int i, int j) { return j * (segs + 1) + i; };
+    for (int i = 0; i < segs; ++i) {
+      addFace(m, {{0, texcoord(i, 0)}, {vertex(i + 1, 1), texcoord(i + 1, 1)}, {vertex(i, 1), texcoord(i, 1)}});
+    }
+    for (int j = 1; j < rings - 1; ++j) {
+      for (int i = 0; i < segs; ++i) {
+        addFace(
+            m,
+            {{vertex(i, j), texcoord(i, j)},
+             {vertex(i + 1, j), texcoord(i + 1, j)},
+             {vertex(i + 1, j + 1), texcoord(i + 1, j + 1)},
+             {vertex(i, j + 1), texcoord(i, j + 1)}}
+        );
+      }
+    }
+    for (int i = 0; i < segs; ++i) {
+      const int j = rings - 1;
+      addFace(
+          m,
+          {{vertex(i, j), texcoord(i, j)}, {vertex(i + 1, j), texcoord(i + 1, j)}, {bottom, texcoord(i, rings)}}
+      );
+    }
+  }
+
+  // 2 * minor segments around the ring, minor segments around the tube
+  static void makeTorus(ObjPolys& m, size_t triangles) {
+    const int minor = std::max(3, (int)std::lround(std::sqrt((double)triangles / 4.0)));
+    const int major = 2 * minor;
+    const double pi = M_PI, ringRadius = 1.0, tubeRadius = 0.35;
+    reserve(
+        m,
+        (size_t)major * minor,
+        (size_t)(major + 1) * (minor + 1),
+        (size_t)major * minor,
+        (size_t)major * minor * 4
+    );
+
+    for (int j = 0; j < minor; ++j) {
+      const double theta = 2.0 * pi * j / minor;
+      for (int i = 0; i < major; ++i) {
+        const double phi = 2.0 * pi * i / major;
+        const double r = ringRadius + tubeRadius * std::cos(theta);
+        addVertex(m, r * std::cos(phi), -tubeRadius * std::sin(theta), r * std::sin(phi));
+      }
+    }
+    for (int j = 0; j <= minor; ++j) {
+      for (int i = 0; i <= major; ++i) addTexcoord(m, (double)i / major, (double)j / minor);
+    }
+
+    auto vertex = [&](int i, int j) { return (j % minor) * major + i % major; };
+    auto texcoord = [&](int i, int j) { return j * (major + 1) + i; };
+    for (int j = 0; j < minor; ++j) {
+      for (int i = 0; i < major; ++i) {
+        addFace(
+            m,
+            {{vertex(i, j), texcoord(i, j)},
+             {vertex(i + 1, j), texcoord(i + 1, j)},
+             {vertex(i + 1, j + 1), texcoord(i + 1, j + 1)},
+             {vertex(i, j + 1), texcoord(i, j + 1)}}
+        );
+      }
+    }
+  }
+
+  // Boxes with sides of s x s quads on a square layout. All boxes share one set of texcoords, an atlas of the
+  // six sides.
+  static void makeHardSurface(ObjPolys& m, size_t triangles) {
+    constexpr int s = 4;
+    constexpr int boxTriangles = 6 * s * s * 2;
+    const int boxes = std::max(1, (int)std::lround((double)triangles / boxTriangles));
+    const int columns = (int)std::ceil(std::sqrt((double)boxes));
+
+    // Side: lattice origin and the two lattice directions, cross(a, b) points outward
+    struct Side {
+      int o[3], a[3], b[3];
+    };
+    const Side sides[6] = {
+        {{s, 0, 0}, {0, 1, 0}, {0, 0, 1}},
+        {{0, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+        {{0, s, 0}, {0, 0, 1}, {1, 0, 0}},
+        {{0, 0, 0}, {1, 0, 0}, {0, 0, 1}},
+        {{0, 0, s}, {1, 0, 0}, {0, 1, 0}},
+        {{0, 0, 0}, {0, 1, 0}, {1, 0, 0}},
+    };
+
+    // Surface points of the box lattice, numbered once and reused by every box
+    std::vector<int> latticeId((size_t)(s + 1) * (s + 1) * (s + 1), -1);
+    std::vector<int> latticePoint;
+    std::vector<std::pair<int, int>> sideCorners; // (box vertex, texcoord), 4 per quad
+    for (int f = 0; f < 6; ++f) {
+      const Side& side = sides[f];
+      auto point = [&](int x, int y) {
+        int p[3];
+        for (int c = 0; c < 3; ++c) p[c] = side.o[c] + side.a[c] * x + side.b[c] * y;
+        const int key = (p[2] * (s + 1) + p[1]) * (s + 1) + p[0];
+        if (latticeId[(size_t)key] < 0) {
+          latticeId[(size_t)key] = (int)latticePoint.size() / 3;
+          latticePoint.insert(latticePoint.end(), {p[0], p[1], p[2]});
+        }
+        return latticeId[(size_t)key];
+      };
+      auto texcoord = [&](int x, int y) { return (f * (s + 1) + y) * (s + 1) + x; };
+      for (int y = 0; y < s; ++y) {
+        for (int x = 0; x < s; ++x) {
+          sideCorners.push_back({point(x, y), texcoord(x, y)});
+          sideCorners.push_back({point(x + 1, y), texcoord(x + 1, y)});
+          sideCorners.push_back({point(x + 1, y + 1), texcoord(x + 1, y + 1)});
+          sideCorners.push_back({point(x, y + 1), texcoord(x, y + 1)});
+        }
+      }
+    }
+    const int boxVertices = (int)latticePoint.size() / 3;
+    reserve(
+        m,
+        (size_t)boxes * boxVertices,
+        6 * (s + 1) * (s + 1),
+        (size_t)boxes * 6 * s * s,
+        (size_t)boxes * sideCorners.size()
+    );
+
+    for (int f = 0; f < 6; ++f) {
+      const double cellU = (f % 3) / 3.0, cellV = (f / 3) / 2.0;
+      for (int y = 0; y <= s; ++y) {
+        for (int x = 0; x <= s; ++x) addTexcoord(m, cellU + 0.3 * x / s, cellV + 0.45 * y / s);
+      }
+    }
+
+    for (int box = 0; box < boxes; ++box) {
+      const double x0 = 1.5 * (box % columns), z0 = 1.5 * (box / columns);
+      const double height = 0.5 + 0.5 * (double)(((uint32_t)box * 2654435761u) >> 30);
+      for (int p = 0; p < boxVertices; ++p) {
+        const int* q = &latticePoint[(size_t)p * 3];
+        addVertex(m, x0 + (double)q[0] / s, height * q[1] / s, z0 + (double)q[2] / s);
+      }
+
+      const int base = box * boxVertices;
+      for (size_t c = 0; c < sideCorners.size(); c += 4) {
+        addFace(
+            m,
+            {{base + sideCorners[c].first, sideCorners[c].second},
+             {base + sideCorners[c + 1].first, sideCorners[c + 1].second},
+             {base + sideCorners[c + 2].first, sideCorners[c + 2].second},
+             {base + sideCorners[c + 3].first, sideCorners[c + 3].second}}
+        );
+      }
+    }
+  }
+
+  const char* syntheticShapeName(SyntheticShape shape) {
+    switch (shape) {
+    case SyntheticShape::Grid: return "grid";
+    case SyntheticShape::Sphere: return "sphere";
+    case SyntheticShape::Torus: return "torus";
+    case SyntheticShape::HardSurface: return "hard";
+    }
+    return "";
+  }
+
+  bool parseSyntheticShape(const std::string& name, SyntheticShape& out) {
+    for (SyntheticShape shape :
+         {SyntheticShape::Grid, SyntheticShape::Sphere, SyntheticShape::Torus, SyntheticShape::HardSurface}) {
+      if (name == syntheticShapeName(shape)) {
+        out = shape;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  ObjPolys makeSyntheticMesh(const SyntheticMeshSettings& settings) {
+    ObjPolys m;
+    switch (settings.shape) {
+    case SyntheticShape::Grid: makeGrid(m, settings.triangles, settings.islands); break;
+    case SyntheticShape::Sphere: makeSphere(m, settings.triangles); break;
+    case SyntheticShape::Torus: makeTorus(m, settings.triangles); break;
+    case SyntheticShape::HardSurface: makeHardSurface(m, settings.triangles); break;
+    }
+    m.nV_in = (int)(m.attrib.vertices.size() / 3);
+    m.nVT_in = (int)(m.attrib.texcoords.size() / 2);
+    return m;
+  }
+
+  bool writeObj(const ObjPolys& m, const std::string& path) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+      std::cerr << "Failed to write OBJ: " << path << "\n";
+      return false;
+    }
+
+    const auto& pos = m.attrib.vertices;
+    const auto& uv = m.attrib.texcoords;
+    for (size_t i = 0; i + 2 < pos.size(); i += 3) {
+      std::fprintf(f, "v %.7g %.7g %.7g\n", pos[i], pos[i + 1], pos[i + 2]);
+    }
+    for (size_t i = 0; i + 1 < uv.size(); i += 2) std::fprintf(f, "vt %.7g %.7g\n", uv[i], uv[i + 1]);
+
+    for (int p = 0; p < m.polys.rows(); ++p) {
+      std::fputc('f', f);
+      for (const tinyobj::index_t& c : m.polys.row(p)) {
+        std::fprintf(f, " %d/%d", c.vertex_index + 1, c.texcoord_index + 1);
+      }
+      std::fputc('\n', f);
+    }
+
+    if (std::fclose(f) != 0) {
+      std::cerr << "Failed to write OBJ: " << path << "\n";
+      return false;
+    }
+    return true;
+  }
+
+} // namespace flowfield::detail
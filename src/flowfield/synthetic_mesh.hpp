@@ -0,0 +1,34 @@
+#pragma once
+
+#include "flowfield_detail.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace flowfield::detail {
+
+  // Procedural UV-mapped meshes for scaling benchmarks, built from quads (plus triangle fans at the sphere's
+  // poles) to about the requested triangle count:
+  //   Grid        plane with a gentle wave, split into islands x islands UV islands of alternating orientation
+  //   Sphere      latitude-longitude sphere, one UV island with a seam
+  //   Torus       torus with seams in both directions, one UV island
+  //   HardSurface rows of subdivided boxes of varying height, a UV island per box side and creases at every box
+  //               edge
+  enum class SyntheticShape { Grid, Sphere, Torus, HardSurface };
+
+  struct SyntheticMeshSettings {
+    SyntheticShape shape = SyntheticShape::Grid;
+    size_t triangles = 100000;
+    int islands = 8; // UV islands per grid side
+  };
+
+  const char* syntheticShapeName(SyntheticShape shape);
+  bool parseSyntheticShape(const std::string& name, SyntheticShape& out);
+
+  // In the layout loadObjAsPolys produces, so the result can go straight into the pipeline stages
+  ObjPolys makeSyntheticMesh(const SyntheticMeshSettings& settings);
+
+  // Writes positions, texcoords and faces as OBJ
+  bool writeObj(const ObjPolys& m, const std::string& path);
+
+} // namespace flowfield::detail
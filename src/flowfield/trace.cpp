@@ -0,0 +1,155 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace {
+
+  namespace {
+
+    struct Event {
+      const char* name;
+      int64_t beginNs;
+      int64_t endNs;
+    };
+
+    // Written by its thread, read by WriteChromeTrace, so both sides take the (uncontended) lock
+    struct ThreadBuffer {
+      std::mutex mutex;
+      std::vector<Event> ring;
+      size_t written = 0; // total events, the ring holds the last traceRingCapacity of them
+      int tid = 0;
+      std::string name;
+    };
+
+    struct Registry {
+      std::mutex mutex;
+      std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    };
+
+    Registry& registry() {
+      static Registry r;
+      return r;
+    }
+
+    // Registered on first use and kept by the registry, so zones of finished threads stay exportable
+    ThreadBuffer& threadBuffer() {
+      thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto b = std::make_shared<ThreadBuffer>();
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        b->tid = (int)r.buffers.size() + 1;
+        r.buffers.push_back(b);
+        return b;
+      }();
+      return *buffer;
+    }
+
+    const auto epoch = std::chrono::steady_clock::now();
+
+    void writeJsonString(FILE* f, const char* s) {
+      std::fputc('"', f);
+      for (; *s; ++s) {
+        const unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') std::fprintf(f, "\\%c", c);
+        else if (c < 0x20) std::fprintf(f, "\\u%04x", c);
+        else std::fputc(c, f);
+      }
+      std::fputc('"', f);
+    }
+
+  } // namespace
+
+  namespace detail {
+
+    std::atomic<bool> enabled{false};
+
+    int64_t nowNs() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void record(const char* name, int64_t beginNs, int64_t endNs) {
+      ThreadBuffer& b = threadBuffer();
+      std::lock_guard<std::mutex> lock(b.mutex);
+      if (b.ring.empty()) b.ring.resize(traceRingCapacity);
+      b.ring[b.written % traceRingCapacity] = Event{name, beginNs, endNs};
+      b.written++;
+    }
+
+  } // namespace detail
+
+  void SetEnabled(bool on) {
+    detail::enabled.store(on, std::memory_order_relaxed);
+  }
+
+  bool IsEnabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+  }
+
+  void SetThreadName(const char* name) {
+    ThreadBuffer& b = threadBuffer();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.name = name;
+  }
+
+  void Clear() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto& b : r.buffers) {
+      std::lock_guard<std::mutex> bufferLock(b->mutex);
+      b->written = 0;
+    }
+  }
+
+  int WriteChromeTrace(const std::string& path) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return -1;
+
+    std::fputs("{\"traceEvents\":[\n", f);
+    bool first = true;
+    int count = 0;
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto& b : r.buffers) {
+      std::lock_guard<std::mutex> bufferLock(b->mutex);
+
+      if (!b->name.empty()) {
+        std::fprintf(
+            f,
+            "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+            first ? "" : ",\n",
+            b->tid
+        );
+        writeJsonString(f, b->name.c_str());
+        std::fputs("}}", f);
+        first = false;
+      }
+
+      const size_t kept = std::min(b->written, traceRingCapacity);
+      for (size_t i = b->written - kept; i < b->written; ++i) {
+        const Event& e = b->ring[i % traceRingCapacity];
+        std::fputs(first ? "{\"ph\":\"X\",\"name\":" : ",\n{\"ph\":\"X\",\"name\":", f);
+        writeJsonString(f, e.name);
+        std::fprintf(
+            f,
+            ",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            b->tid,
+            e.beginNs / 1000.0,
+            (e.endNs - e.beginNs) / 1000.0
+        );
+        first = false;
+        count++;
+      }
+    }
+
+    std::fputs("\n]}\n", f);
+    const bool ok = std::fclose(f) == 0;
+    return ok ? count : -1;
+  }
+
+} // namespace trace
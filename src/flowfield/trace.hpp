@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped-zone tracer. TRACE_ZONE("name") records the time from its line to the end of the enclosing scope
+// into a ring buffer of the calling thread, holding the last traceRingCapacity zones per thread. While
+// recording is off a zone costs one relaxed atomic load. Names must be string literals or otherwise outlive
+// the trace.
+namespace trace {
+
+  constexpr size_t traceRingCapacity = size_t(1) << 15;
+
+  void SetEnabled(bool enabled);
+  bool IsEnabled();
+
+  // Name of the calling thread in the exported trace
+  void SetThreadName(const char* name);
+
+  // Drops all recorded zones
+  void Clear();
+
+  // Writes the recorded zones of all threads in the Chrome trace event format, e.g. for chrome://tracing
+  // or ui.perfetto.dev. Returns the number of zones written, -1 if the file cannot be written.
+  int WriteChromeTrace(const std::string& path);
+
+  namespace detail {
+    extern std::atomic<bool> enabled;
+    int64_t nowNs();
+    void record(const char* name, int64_t beginNs, int64_t endNs);
+  } // namespace detail
+
+  class Zone {
+  public:
+    explicit Zone(const char* name):
+      name(name),
+      beginNs(detail::enabled.load(std::memory_order_relaxed) ? detail::nowNs() : -1) {}
+    ~Zone() {
+      if (beginNs >= 0) detail::record(name, beginNs, detail::nowNs());
+    }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+  private:
+    const char* name;
+    int64_t beginNs;
+  };
+
+} // namespace trace
+
+#define TRACE_ZONE_CONCAT_(a, b) a##b
+#define TRACE_ZONE_CONCAT(a, b) TRACE_ZONE_CONCAT_(a, b)
+#define TRACE_ZONE(name) ::trace::Zone TRACE_ZONE_CONCAT(traceZone, __LINE__)(name)
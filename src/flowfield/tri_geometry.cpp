@@ -0,0 +1,287 @@
+#include "tri_geometry.hpp"
+
+#include "parallel.hpp"
+#include "trace.hpp"
+#include "tri_geometry_kernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOWFIELD_HAS_SSE_KERNEL 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace flowfield::detail {
+
+  static_assert(std::is_same<tinyobj::real_t, float>::value, "the float32 kernels read tinyobj attributes directly");
+
+  void TriGeometry::resize(size_t n) {
+    for (auto* v : {&nx, &ny, &nz, &area, &ux, &uy, &uz, &vx, &vy, &vz}) v->resize(n);
+  }
+
+#ifdef FLOWFIELD_HAS_SSE_KERNEL
+
+  // SSE2 only, so the fallback runs on every x86-64 CPU
+  struct SseOps {
+    using T = __m128;
+    static constexpr size_t width = 4;
+
+    static T set1(float x) { return _mm_set1_ps(x); }
+    static T zero() { return _mm_setzero_ps(); }
+    static T load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, T a) { _mm_storeu_ps(p, a); }
+    static T gather(const float* base, const int32_t* idx) {
+      return _mm_setr_ps(base[idx[0]], base[idx[1]], base[idx[2]], base[idx[3]]);
+    }
+
+    static T add(T a, T b) { return _mm_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm_sub_ps(a, b); }
+    static T mul(T a, T b) { return _mm_mul_ps(a, b); }
+    static T div(T a, T b) { return _mm_div_ps(a, b); }
+    static T sqrt(T a) { return _mm_sqrt_ps(a); }
+    static T abs(T a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+    static T cmpGe(T a, T b) { return _mm_cmpge_ps(a, b); }
+    static T bitAnd(T a, T b) { return _mm_and_ps(a, b); }
+    static T select(T mask, T a, T b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+  };
+
+  void triGeometrySse(const GeometryStreams& s, size_t begin, size_t end) {
+    triGeometrySimd<SseOps>(s, begin, end);
+  }
+
+#else
+
+  void triGeometrySse(const GeometryStreams&, size_t, size_t) {}
+
+#endif
+
+  // One lane of the SIMD body, so the portable path performs the same float operations in the same order and
+  // gives the same bits as the vector kernels. Lane masks are all-ones or all-zeros bit patterns, as in SSE.
+  struct ScalarOps {
+    using T = float;
+    static constexpr size_t width = 1;
+
+    static T set1(float x) { return x; }
+    static T zero() { return 0.0f; }
+    static T load(const float* p) { return *p; }
+    static void store(float* p, T a) { *p = a; }
+    static T gather(const float* base, const int32_t* idx) { return base[idx[0]]; }
+
+    static T add(T a, T b) { return a + b; }
+    static T sub(T a, T b) { return a - b; }
+    static T mul(T a, T b) { return a * b; }
+    static T div(T a, T b) { return a / b; }
+    static T sqrt(T a) { return std::sqrt(a); }
+    static T abs(T a) { return std::fabs(a); }
+
+    static T cmpGe(T a, T b) { return fromBits(a >= b ? ~0u : 0u); }
+    static T bitAnd(T a, T b) { return fromBits(bits(a) & bits(b)); }
+    static T select(T mask, T a, T b) { return bits(mask) ? a : b; }
+
+    static uint32_t bits(T a) {
+      uint32_t u;
+      std::memcpy(&u, &a, sizeof(u));
+      return u;
+    }
+    static T fromBits(uint32_t u) {
+      T a;
+      std::memcpy(&a, &u, sizeof(a));
+      return a;
+    }
+  };
+
+  static void triGeometryScalar(const GeometryStreams& s, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) triGeometryLanes<ScalarOps>(s, i);
+  }
+
+  // The same math in double, what the float kernels are validated against
+  static void triGeometryReference(const GeometryStreams& s, size_t begin, size_t end) {
+    using Real = double;
+    using Vec3 = Eigen::Matrix<Real, 3, 1>;
+    using Vec2 = Eigen::Matrix<Real, 2, 1>;
+
+    for (size_t i = begin; i < end; ++i) {
+      const float* q0 = s.pos + s.p[0][i];
+      const float* q1 = s.pos + s.p[1][i];
+      const float* q2 = s.pos + s.p[2][i];
+      const Vec3 p0(q0[0], q0[1], q0[2]), p1(q1[0], q1[1], q1[2]), p2(q2[0], q2[1], q2[2]);
+
+      const Vec3 e1 = p1 - p0;
+      const Vec3 e2 = p2 - p0;
+      const Vec3 c = e1.cross(e2);
+      const Real dblA = c.norm();
+
+      Vec3 n = Vec3::Zero();
+      Vec3 dPdu = Vec3::Zero();
+      Vec3 dPdv = Vec3::Zero();
+      Real area = 0;
+
+      if (dblA >= Real(1e-20)) {
+        n = c / dblA;
+        area = Real(0.5) * dblA;
+
+        const float* t0 = s.uv + s.t[0][i];
+        const float* t1 = s.uv + s.t[1][i];
+        const float* t2 = s.uv + s.t[2][i];
+        const Vec2 d1 = Vec2(t1[0], t1[1]) - Vec2(t0[0], t0[1]);
+        const Vec2 d2 = Vec2(t2[0], t2[1]) - Vec2(t0[0], t0[1]);
+        const Real denom = d1.x() * d2.y() - d2.x() * d1.y();
+
+        if (s.uvValid[i] >= 0.5f && std::abs(denom) >= Real(1e-20)) {
+          const Real r = Real(1) / denom;
+          dPdu = (e1 * d2.y() - e2 * d1.y()) * r;
+          dPdv = (e2 * d1.x() - e1 * d2.x()) * r;
+          dPdu -= n * n.dot(dPdu);
+          dPdv -= n * n.dot(dPdv);
+        }
+      }
+
+      s.nx[i] = (float)n.x();
+      s.ny[i] = (float)n.y();
+      s.nz[i] = (float)n.z();
+      s.area[i] = (float)area;
+      s.ux[i] = (float)dPdu.x();
+      s.uy[i] = (float)dPdu.y();
+      s.uz[i] = (float)dPdu.z();
+      s.vx[i] = (float)dPdv.x();
+      s.vy[i] = (float)dPdv.y();
+      s.vz[i] = (float)dPdv.z();
+    }
+  }
+
+  static bool cpuHasAvx2() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // AVX2 also needs the OS to save the YMM registers
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+  }
+
+  bool geometryKernelSupported(GeometryKernel kernel) {
+    switch (kernel) {
+    case GeometryKernel::Reference:
+    case GeometryKernel::Scalar: return true;
+#ifdef FLOWFIELD_HAS_SSE_KERNEL
+    case GeometryKernel::Sse: return true;
+#endif
+    case GeometryKernel::Avx2: {
+      static const bool supported = avx2KernelCompiled() && cpuHasAvx2();
+      return supported;
+    }
+    default: return false;
+    }
+  }
+
+  // Kernel set with forceGeometryKernel, -1 for none
+  static std::atomic<int> forcedKernel{-1};
+
+  void forceGeometryKernel(std::optional<GeometryKernel> kernel) {
+    forcedKernel = kernel ? (int)*kernel : -1;
+  }
+
+  GeometryKernel bestGeometryKernel() {
+    const int forced = forcedKernel;
+    if (forced >= 0 && geometryKernelSupported((GeometryKernel)forced)) return (GeometryKernel)forced;
+    if (geometryKernelSupported(GeometryKernel::Avx2)) return GeometryKernel::Avx2;
+    if (geometryKernelSupported(GeometryKernel::Sse)) return GeometryKernel::Sse;
+    return GeometryKernel::Scalar;
+  }
+
+  const char* geometryKernelName(GeometryKernel kernel) {
+    switch (kernel) {
+    case GeometryKernel::Reference: return "reference";
+    case GeometryKernel::Scalar: return "scalar";
+    case GeometryKernel::Sse: return "sse";
+    case GeometryKernel::Avx2: return "avx2";
+    }
+    return "unknown";
+  }
+
+  void computeTriGeometry(
+      const ObjPolys& m,
+      const std::vector<Tri>& tris,
+      TriGeometry& out,
+      int threads,
+      GeometryKernel kernel
+  ) {
+    TRACE_ZONE("computeTriGeometry");
+    const size_t nT = tris.size();
+    out.resize(nT);
+    if (nT == 0) return;
+    if (!geometryKernelSupported(kernel)) kernel = bestGeometryKernel();
+
+    // Corner offsets in SoA layout. Triangles with invalid vertices collapse onto vertex 0 and come out
+    // degenerate, missing texcoords read a zero dummy, so every gather stays in bounds.
+    static const float noUv[2] = {0.0f, 0.0f};
+    std::vector<int32_t> offsets(nT * 6);
+    std::vector<float> uvValid(nT);
+
+    parallelFor(nT, threads, [&](size_t begin, size_t end, int) {
+      for (size_t ti = begin; ti < end; ++ti) {
+        const Tri& t = tris[ti];
+        const bool posOk = std::min({t.v0(), t.v1(), t.v2()}) >= 0 && std::max({t.v0(), t.v1(), t.v2()}) < m.nV_in;
+        bool uvOk = true;
+
+        for (int k = 0; k < 3; ++k) {
+          const tinyobj::index_t& idx = t.corner(k).idx;
+          const bool hasVt = idx.texcoord_index >= 0 && idx.texcoord_index < m.nVT_in;
+          offsets[(size_t)k * nT + ti] = posOk ? 3 * idx.vertex_index : 0;
+          offsets[(size_t)(3 + k) * nT + ti] = hasVt ? 2 * idx.texcoord_index : 0;
+          uvOk &= hasVt;
+        }
+        uvValid[ti] = uvOk ? 1.0f : 0.0f;
+      }
+    });
+
+    GeometryStreams s;
+    s.pos = m.attrib.vertices.data();
+    s.uv = m.attrib.texcoords.empty() ? noUv : m.attrib.texcoords.data();
+    for (int k = 0; k < 3; ++k) {
+      s.p[k] = offsets.data() + (size_t)k * nT;
+      s.t[k] = offsets.data() + (size_t)(3 + k) * nT;
+    }
+    s.uvValid = uvValid.data();
+    s.nx = out.nx.data();
+    s.ny = out.ny.data();
+    s.nz = out.nz.data();
+    s.area = out.area.data();
+    s.ux = out.ux.data();
+    s.uy = out.uy.data();
+    s.uz = out.uz.data();
+    s.vx = out.vx.data();
+    s.vy = out.vy.data();
+    s.vz = out.vz.data();
+
+    void (*fn)(const GeometryStreams&, size_t, size_t) = triGeometryScalar;
+    if (kernel == GeometryKernel::Reference) fn = triGeometryReference;
+    else if (kernel == GeometryKernel::Sse) fn = triGeometrySse;
+    else if (kernel == GeometryKernel::Avx2) fn = triGeometryAvx2;
+
+    parallelFor(nT, threads, [&](size_t begin, size_t end, int) { fn(s, begin, end); });
+  }
+
+} // namespace flowfield::detail
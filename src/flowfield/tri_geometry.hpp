@@ -0,0 +1,56 @@
+#pragma once
+
+#include "flowfield_detail.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace flowfield::detail {
+
+  // Implementations of computeTriGeometry. Reference evaluates in double and is what the float paths are
+  // validated against; Scalar, Sse and Avx2 evaluate in float32 with the same operations in the same order and
+  // give bit-identical results, so bakes do not depend on the CPU. That relies on the flowfield library being
+  // built without floating-point contraction into FMA (see CMakeLists.txt).
+  enum class GeometryKernel { Reference, Scalar, Sse, Avx2 };
+
+  // Validated tolerance of the float kernels against Reference (flowfield_bench geometry): normals and
+  // tangent directions agree within geometryAngleTolerance radians and areas within geometryAreaTolerance
+  // relative error on triangles whose shape 2 * area / longestEdge^2 is at least geometryShapeThreshold,
+  // in both position and UV space. Slivers below that are only as well-defined as their float32 inputs.
+  constexpr double geometryAngleTolerance = 1e-4;
+  constexpr double geometryAreaTolerance = 1e-5;
+  constexpr double geometryShapeThreshold = 1e-3;
+
+  // Per-triangle geometry of a triangulation in float32 structure-of-arrays layout
+  struct TriGeometry {
+    std::vector<float> nx, ny, nz; // unit normal, zero for degenerate triangles
+    std::vector<float> area;       // zero for degenerate triangles
+    std::vector<float> ux, uy, uz; // dP/du projected into the triangle plane, zero without usable UVs
+    std::vector<float> vx, vy, vz; // dP/dv, likewise
+
+    size_t size() const { return area.size(); }
+    void resize(size_t n);
+
+    Eigen::Vector3d normal(size_t t) const { return Eigen::Vector3d(nx[t], ny[t], nz[t]); }
+    Eigen::Vector3d dPdu(size_t t) const { return Eigen::Vector3d(ux[t], uy[t], uz[t]); }
+    Eigen::Vector3d dPdv(size_t t) const { return Eigen::Vector3d(vx[t], vy[t], vz[t]); }
+  };
+
+  // Fastest kernel supported by the running CPU, or the one set with forceGeometryKernel
+  GeometryKernel bestGeometryKernel();
+  // Runs every later bake on kernel when the CPU supports it, nullopt restores the default. For comparing
+  // whole bakes across kernels (flowfield_bench checksum), set it while no bake runs.
+  void forceGeometryKernel(std::optional<GeometryKernel> kernel);
+  bool geometryKernelSupported(GeometryKernel kernel);
+  const char* geometryKernelName(GeometryKernel kernel);
+
+  void computeTriGeometry(
+      const ObjPolys& m,
+      const std::vector<Tri>& tris,
+      TriGeometry& out,
+      int threads,
+      GeometryKernel kernel = bestGeometryKernel()
+  );
+
+} // namespace flowfield::detail
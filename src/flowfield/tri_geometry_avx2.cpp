@@ -0,0 +1,56 @@
+// Built with AVX2 code generation (see CMakeLists.txt) and only entered after a runtime CPU check.
+// Keep this file free of standard library includes, see GeometryStreams.
+#include "tri_geometry_kernels.hpp"
+
+#if defined(__AVX2__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#define FLOWFIELD_HAS_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+namespace flowfield::detail {
+
+#ifdef FLOWFIELD_HAS_AVX2_KERNEL
+
+  struct Avx2Ops {
+    using T = __m256;
+    static constexpr size_t width = 8;
+
+    static T set1(float x) { return _mm256_set1_ps(x); }
+    static T zero() { return _mm256_setzero_ps(); }
+    static T load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, T a) { _mm256_storeu_ps(p, a); }
+    static T gather(const float* base, const int32_t* idx) {
+      return _mm256_i32gather_ps(base, _mm256_loadu_si256((const __m256i*)idx), 4);
+    }
+
+    static T add(T a, T b) { return _mm256_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm256_sub_ps(a, b); }
+    static T mul(T a, T b) { return _mm256_mul_ps(a, b); }
+    static T div(T a, T b) { return _mm256_div_ps(a, b); }
+    static T sqrt(T a) { return _mm256_sqrt_ps(a); }
+    static T abs(T a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+    static T cmpGe(T a, T b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static T bitAnd(T a, T b) { return _mm256_and_ps(a, b); }
+    static T select(T mask, T a, T b) { return _mm256_blendv_ps(b, a, mask); }
+  };
+
+  void triGeometryAvx2(const GeometryStreams& s, size_t begin, size_t end) {
+    triGeometrySimd<Avx2Ops>(s, begin, end);
+  }
+
+  bool avx2KernelCompiled() {
+    return true;
+  }
+
+#else
+
+  void triGeometryAvx2(const GeometryStreams&, size_t, size_t) {}
+
+  bool avx2KernelCompiled() {
+    return false;
+  }
+
+#endif
+
+} // namespace flowfield::detail
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace flowfield::detail {
+
+  // Raw views handed to the kernels. Only plain pointers cross into the instruction-set specific translation
+  // units, so no inline library code ends up compiled there with instructions the running CPU may lack.
+  struct GeometryStreams {
+    const float* pos = nullptr;     // xyz per vertex
+    const float* uv = nullptr;      // uv per texcoord
+    const int32_t* p[3] = {};       // per corner: offset of its position in pos
+    const int32_t* t[3] = {};       // per corner: offset of its texcoord in uv, 0 when missing
+    const float* uvValid = nullptr; // per triangle: 1 if all three texcoords are present
+
+    float* nx = nullptr;
+    float* ny = nullptr;
+    float* nz = nullptr;
+    float* area = nullptr;
+    float* ux = nullptr;
+    float* uy = nullptr;
+    float* uz = nullptr;
+    float* vx = nullptr;
+    float* vy = nullptr;
+    float* vz = nullptr;
+  };
+
+  void triGeometrySse(const GeometryStreams& s, size_t begin, size_t end);
+  void triGeometryAvx2(const GeometryStreams& s, size_t begin, size_t end);
+
+  // False when the AVX2 translation unit was built without AVX2 code generation
+  bool avx2KernelCompiled();
+
+  // Kernel body for V::width triangles starting at i. V wraps one instruction set: a register type T and
+  // set1/zero/load/store/gather, add/sub/mul/div/sqrt/abs, cmpGe (lane mask), bitAnd and select(mask, a, b).
+  template<typename V>
+  inline void triGeometryLanes(const GeometryStreams& s, size_t i) {
+    using T = typename V::T;
+
+    const T x0 = V::gather(s.pos + 0, s.p[0] + i), y0 = V::gather(s.pos + 1, s.p[0] + i);
+    const T z0 = V::gather(s.pos + 2, s.p[0] + i);
+    const T x1 = V::gather(s.pos + 0, s.p[1] + i), y1 = V::gather(s.pos + 1, s.p[1] + i);
+    const T z1 = V::gather(s.pos + 2, s.p[1] + i);
+    const T x2 = V::gather(s.pos + 0, s.p[2] + i), y2 = V::gather(s.pos + 1, s.p[2] + i);
+    const T z2 = V::gather(s.pos + 2, s.p[2] + i);
+
+    const T e1x = V::sub(x1, x0), e1y = V::sub(y1, y0), e1z = V::sub(z1, z0);
+    const T e2x = V::sub(x2, x0), e2y = V::sub(y2, y0), e2z = V::sub(z2, z0);
+
+    const T cx = V::sub(V::mul(e1y, e2z), V::mul(e1z, e2y));
+    const T cy = V::sub(V::mul(e1z, e2x), V::mul(e1x, e2z));
+    const T cz = V::sub(V::mul(e1x, e2y), V::mul(e1y, e2x));
+
+    const T dblA = V::sqrt(V::add(V::add(V::mul(cx, cx), V::mul(cy, cy)), V::mul(cz, cz)));
+    const T valid = V::cmpGe(dblA, V::set1(1e-20f));
+    const T invA = V::select(valid, V::div(V::set1(1.0f), dblA), V::zero());
+
+    const T nx = V::mul(cx, invA), ny = V::mul(cy, invA), nz = V::mul(cz, invA);
+    V::store(s.nx + i, nx);
+    V::store(s.ny + i, ny);
+    V::store(s.nz + i, nz);
+    V::store(s.area + i, V::select(valid, V::mul(V::set1(0.5f), dblA), V::zero()));
+
+    const T u0 = V::gather(s.uv + 0, s.t[0] + i), v0 = V::gather(s.uv + 1, s.t[0] + i);
+    const T u1 = V::gather(s.uv + 0, s.t[1] + i), v1 = V::gather(s.uv + 1, s.t[1] + i);
+    const T u2 = V::gather(s.uv + 0, s.t[2] + i), v2 = V::gather(s.uv + 1, s.t[2] + i);
+
+    const T d1u = V::sub(u1, u0), d1v = V::sub(v1, v0);
+    const T d2u = V::sub(u2, u0), d2v = V::sub(v2, v0);
+    const T denom = V::sub(V::mul(d1u, d2v), V::mul(d2u, d1v));
+
+    T tanOk = V::bitAnd(valid, V::cmpGe(V::abs(denom), V::set1(1e-20f)));
+    tanOk = V::bitAnd(tanOk, V::cmpGe(V::load(s.uvValid + i), V::set1(0.5f)));
+    const T r = V::select(tanOk, V::div(V::set1(1.0f), denom), V::zero());
+
+    // dPdu = (e1 * d2v - e2 * d1v) * r, dPdv = (e2 * d1u - e1 * d2u) * r, both projected into the plane
+    T ux = V::mul(V::sub(V::mul(e1x, d2v), V::mul(e2x, d1v)), r);
+    T uy = V::mul(V::sub(V::mul(e1y, d2v), V::mul(e2y, d1v)), r);
+    T uz = V::mul(V::sub(V::mul(e1z, d2v), V::mul(e2z, d1v)), r);
+    T vx = V::mul(V::sub(V::mul(e2x, d1u), V::mul(e1x, d2u)), r);
+    T vy = V::mul(V::sub(V::mul(e2y, d1u), V::mul(e1y, d2u)), r);
+    T vz = V::mul(V::sub(V::mul(e2z, d1u), V::mul(e1z, d2u)), r);
+
+    const T du = V::add(V::add(V::mul(nx, ux), V::mul(ny, uy)), V::mul(nz, uz));
+    const T dv = V::add(V::add(V::mul(nx, vx), V::mul(ny, vy)), V::mul(nz, vz));
+    ux = V::sub(ux, V::mul(nx, du));
+    uy = V::sub(uy, V::mul(ny, du));
+    uz = V::sub(uz, V::mul(nz, du));
+    vx = V::sub(vx, V::mul(nx, dv));
+    vy = V::sub(vy, V::mul(ny, dv));
+    vz = V::sub(vz, V::mul(nz, dv));
+
+    V::store(s.ux + i, ux);
+    V::store(s.uy + i, uy);
+    V::store(s.uz + i, uz);
+    V::store(s.vx + i, vx);
+    V::store(s.vy + i, vy);
+    V::store(s.vz + i, vz);
+  }
+
+  // Full vector iterations over [begin, end), then the tail through padded stack copies so every triangle
+  // goes through the same instruction sequence.
+  template<typename V>
+  inline void triGeometrySimd(const GeometryStreams& s, size_t begin, size_t end) {
+    constexpr size_t w = V::width;
+
+    size_t i = begin;
+    for (; i + w <= end; i += w) triGeometryLanes<V>(s, i);
+    if (i == end) return;
+
+    const size_t rest = end - i;
+    int32_t idx[6][w] = {};
+    float uvValid[w] = {};
+    float out[10][w];
+
+    GeometryStreams tail;
+    tail.pos = s.pos;
+    tail.uv = s.uv;
+    for (int k = 0; k < 3; ++k) {
+      for (size_t j = 0; j < rest; ++j) {
+        idx[k][j] = s.p[k][i + j];
+        idx[3 + k][j] = s.t[k][i + j];
+      }
+      tail.p[k] = idx[k];
+      tail.t[k] = idx[3 + k];
+    }
+    for (size_t j = 0; j < rest; ++j) uvValid[j] = s.uvValid[i + j];
+    tail.uvValid = uvValid;
+
+    float* const dst[10] = {s.nx, s.ny, s.nz, s.area, s.ux, s.uy, s.uz, s.vx, s.vy, s.vz};
+    float** const tailDst[10] = {
+        &tail.nx, &tail.ny, &tail.nz, &tail.area, &tail.ux, &tail.uy, &tail.uz, &tail.vx, &tail.vy, &tail.vz
+    };
+    for (int k = 0; k < 10; ++k) *tailDst[k] = out[k];
+
+    triGeometryLanes<V>(tail, 0);
+
+    for (int k = 0; k < 10; ++k) {
+      for (size_t j = 0; j < rest; ++j) dst[k][i + j] = out[k][j];
+    }
+  }
+
+} // namespace flowfield::detail
@@ -1,16 +1,33 @@
 #include "mesh.hpp"
 
 #include "flowfield/flowfield.hpp"
+#include "flowfield/flowfield_cache.hpp"
+#include "flowfield/flowfield_optimize.hpp"
+#include "flowfield/flowfield_stream.hpp"
+#include "flowfield/trace.hpp"
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
 
-void Mesh::UploadIndexed(const void* vertexData, size_t vertexBytes, const unsigned int* indices, size_t indexCount) {
+// OBJ files from this size on are baked out of core straight into the cache
+static constexpr uintmax_t streamingBakeMinFileSize = (uintmax_t)1 << 30;
+
+static size_t indexSize(GLenum indexType) {
+  return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
+void Mesh::UploadIndexed(
+    const void* vertexData, size_t vertexBytes, const void* indices, size_t indexCount, GLenum indexType
+) {
   Destroy();
 
   this->indexCount = indexCount;
+  this->indexType = indexType;
   vertexCount = 0;
+  gpuBytes = vertexBytes + indexSize(indexType) * indexCount;
   glGenVertexArrays(1, &vao);
   glGenBuffers(1, &vbo);
   glGenBuffers(1, &ebo);
@@ -18,7 +35,7 @@ void Mesh::UploadIndexed(const void* vertexData, size_t vertexBytes, const unsig
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
   glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indexCount, indices, GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize(indexType) * indexCount, indices, GL_STATIC_DRAW);
   glBindVertexArray(0);
 }
 
@@ -46,15 +63,18 @@ void Mesh::SetAttrib(
   glBindVertexArray(0);
 }
 
-void Mesh::Draw(int renderFlags) const {
+void Mesh::Draw(int renderFlags, int lod) const {
   if (!vao) return;
   glBindVertexArray(vao);
 
   if (renderFlags & RenderFlag::DepthTest) glEnable(GL_DEPTH_TEST);
   if (renderFlags & RenderFlag::CullFace) glEnable(GL_CULL_FACE);
 
-  if (indexCount > 0) {
-    glDrawElements(GL_TRIANGLES, (GLsizei)indexCount, GL_UNSIGNED_INT, 0);
+  if (!lods.empty()) {
+    const FlowfieldLod& l = lods[std::clamp(lod, 0, (int)lods.size() - 1)];
+    glDrawElements(GL_TRIANGLES, (GLsizei)l.indexCount, indexType, (void*)(l.indexOffset * indexSize(indexType)));
+  } else if (indexCount > 0) {
+    glDrawElements(GL_TRIANGLES, (GLsizei)indexCount, indexType, 0);
   } else {
     glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertexCount);
   }
@@ -79,7 +99,20 @@ void Mesh::Destroy() {
 }
 
 Mesh::Mesh(Mesh&& other) noexcept:
-  vao(other.vao), vbo(other.vbo), ebo(other.ebo), indexCount(other.indexCount), vertexCount(other.vertexCount) {
+  vao(other.vao),
+  vbo(other.vbo),
+  ebo(other.ebo),
+  indexCount(other.indexCount),
+  vertexCount(other.vertexCount),
+  indexType(other.indexType),
+  lods(std::move(other.lods)),
+  boundsCenter(other.boundsCenter),
+  boundsRadius(other.boundsRadius),
+  posScale(other.posScale),
+  posOffset(other.posOffset),
+  octFlow(other.octFlow),
+  gpuBytes(other.gpuBytes),
+  drawOrder(other.drawOrder) {
   other.vao = 0;
   other.vbo = 0;
   other.ebo = 0;
@@ -93,6 +126,15 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept {
     ebo = other.ebo;
     indexCount = other.indexCount;
     vertexCount = other.vertexCount;
+    indexType = other.indexType;
+    lods = std::move(other.lods);
+    boundsCenter = other.boundsCenter;
+    boundsRadius = other.boundsRadius;
+    posScale = other.posScale;
+    posOffset = other.posOffset;
+    octFlow = other.octFlow;
+    gpuBytes = other.gpuBytes;
+    drawOrder = other.drawOrder;
     other.vao = 0;
     other.vbo = 0;
     other.ebo = 0;
@@ -121,22 +163,118 @@ Mesh Mesh::CreateTriangle() {
   return m;
 }
 
-MeshFlowfieldData Mesh::CreateFlowfieldDataFromOBJ(
-    int slot, const std::string& path, const FlowfieldSettings& settings
+static MeshFlowfieldData loadFlowfieldData(
+    int slot, const std::string& path, const FlowfieldSettings& settings, FlowfieldBaker* baker
 ) {
   MeshFlowfieldData data;
+  data.slot = slot;
 
-  bool ok = ComputeUvFlowfieldFromOBJ(path, data.verts, data.indices, settings);
+  // Large files bake out of core, which has its own cache entries
+  std::error_code ec;
+  const uintmax_t fileSize = std::filesystem::file_size(path, ec);
+  const bool streamed = !ec && fileSize >= streamingBakeMinFileSize;
+  const FlowfieldCacheLayout layout = streamed ? FlowfieldCacheLayout::Streamed : FlowfieldCacheLayout::InMemory;
 
-  if (ok) std::cout << "Loaded " << path << " (" << (data.verts.size() / 6) << " vertices)" << std::endl;
+  bool objOk = false;
+  const uint64_t objHash = HashFileContents(path, &objOk);
+  if (objOk && LoadFlowfieldCache(objHash, settings, layout, data.cached)) {
+    data.drawOrder.after = AnalyzeFlowfieldMesh(
+        data.IndexData(), data.IndexCount(), data.VertexFloatCount() / 6, data.LodData(), data.LodCount()
+    );
+    std::cout << "Loaded " << path << " from cache (" << (data.VertexFloatCount() / 6) << " vertices)" << std::endl;
+    return data;
+  }
+
+  if (streamed) {
+    if (BakeFlowfieldStreaming(path, objHash, settings) &&
+        LoadFlowfieldCache(objHash, settings, layout, data.cached)) {
+      data.drawOrder.after = AnalyzeFlowfieldMesh(data.IndexData(), data.IndexCount(), data.VertexFloatCount() / 6);
+      std::cout << "Loaded " << path << " out of core (" << (data.VertexFloatCount() / 6) << " vertices)" << std::endl;
+    }
+    return data;
+  }
+
+  bool ok = baker ? baker->Bake(path, data.verts, data.indices, settings, &data.lods, nullptr, &data.drawOrder)
+                  : ComputeUvFlowfieldFromOBJ(
+                        path, data.verts, data.indices, settings, &data.lods, nullptr, &data.drawOrder
+                    );
+
+  if (ok) {
+    if (!settings.optimizeDrawOrder) data.drawOrder.before = VertexCacheStats();
+    std::cout << "Loaded " << path << " (" << (data.verts.size() / 6) << " vertices, " << data.lods.size()
+              << " LODs)" << std::endl;
+    StoreFlowfieldCache(objHash, settings, layout, data.verts, data.indices, data.lods);
+  }
+
+  return data;
+}
+
+MeshFlowfieldData Mesh::CreateFlowfieldDataFromOBJ(
+    int slot, const std::string& path, const FlowfieldSettings& settings, FlowfieldBaker* baker, int compactFlowBits
+) {
+  MeshFlowfieldData data = loadFlowfieldData(slot, path, settings, baker);
+
+  if (compactFlowBits > 0 && data.IndexCount() > 0) {
+    const bool ok = QuantizeFlowfieldMesh(
+        data.VertexData(), data.VertexFloatCount(), data.IndexData(), data.IndexCount(), compactFlowBits, data.compact
+    );
+    if (ok) {
+      std::cout << "Compacted " << path << " (flow error " << data.compact.maxFlowErrorDeg << " deg, position error "
+                << data.compact.maxPositionError << ")" << std::endl;
+    }
+  }
 
-  data.slot = slot;
   return data;
 }
 
 void Mesh::UploadFlowfieldMesh(const MeshFlowfieldData& d) {
-  if (d.indices.empty()) return;
-  UploadIndexed(d.verts.data(), d.verts.size() * sizeof(float), d.indices.data(), d.indices.size());
-  SetAttrib(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), 0);
-  SetAttrib(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), 3 * sizeof(float));
+  TRACE_ZONE("Mesh::UploadFlowfieldMesh");
+  if (d.IndexCount() == 0) return;
+
+  if (!d.compact.empty()) {
+    const QuantizedFlowfieldMesh& q = d.compact;
+    const bool shortIndices = !q.shortIndices.empty();
+    UploadIndexed(
+        q.vertexData.data(),
+        q.vertexData.size(),
+        shortIndices ? (const void*)q.shortIndices.data() : d.IndexData(),
+        d.IndexCount(),
+        shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT
+    );
+    SetAttrib(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, (GLsizei)q.stride, 0);
+    SetAttrib(1, 2, q.flowBits == 16 ? GL_SHORT : GL_BYTE, GL_TRUE, (GLsizei)q.stride, q.flowOffset);
+
+    posScale = glm::vec3(q.boundsExtent[0], q.boundsExtent[1], q.boundsExtent[2]);
+    posOffset = glm::vec3(q.boundsMin[0], q.boundsMin[1], q.boundsMin[2]);
+    octFlow = true;
+  } else {
+    UploadIndexed(d.VertexData(), d.VertexFloatCount() * sizeof(float), d.IndexData(), d.IndexCount());
+    SetAttrib(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), 0);
+    SetAttrib(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), 3 * sizeof(float));
+
+    posScale = glm::vec3(1.0f);
+    posOffset = glm::vec3(0.0f);
+    octFlow = false;
+  }
+
+  lods.assign(d.LodData(), d.LodData() + d.LodCount());
+  drawOrder = d.drawOrder;
+
+  const float* v = d.VertexData();
+  glm::vec3 lo(v[0], v[1], v[2]), hi = lo;
+  for (size_t i = 0; i < d.VertexFloatCount(); i += 6) {
+    const glm::vec3 p(v[i], v[i + 1], v[i + 2]);
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  boundsCenter = 0.5f * (lo + hi);
+  boundsRadius = 0.5f * glm::length(hi - lo);
+}
+
+int Mesh::SelectLod(float pixelsPerUnit, float maxPixelError) const {
+  int lod = 0;
+  for (int i = 1; i < (int)lods.size(); ++i) {
+    if (lods[i].error * pixelsPerUnit <= maxPixelError) lod = i;
+  }
+  return lod;
 }
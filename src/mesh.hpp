@@ -1,47 +1,90 @@
 #pragma once
+#include "flowfield/flowfield.hpp"
+#include "flowfield/flowfield_cache.hpp"
+#include "flowfield/flowfield_quantize.hpp"
+
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
 #include <string>
 #include <vector>
 
-struct FlowfieldSettings;
-
 struct MeshFlowfieldData {
   std::vector<float> verts;
   std::vector<unsigned int> indices;
+  std::vector<FlowfieldLod> lods;
+  FlowfieldCacheEntry cached;     // used instead of verts/indices/lods on a cache hit
+  QuantizedFlowfieldMesh compact; // uploaded instead of the float vertices and 32-bit indices when not empty
+  FlowfieldDrawOrderStats drawOrder; // before only for fresh bakes that optimized the draw order, 0 otherwise
   int slot = -1;
 
   MeshFlowfieldData() = default;
   MeshFlowfieldData(const MeshFlowfieldData&) = delete;
   MeshFlowfieldData(MeshFlowfieldData&&) = default;
+
+  const float* VertexData() const { return cached ? cached.verts : verts.data(); }
+  size_t VertexFloatCount() const { return cached ? cached.vertFloatCount : verts.size(); }
+  const unsigned int* IndexData() const { return cached ? cached.indices : indices.data(); }
+  size_t IndexCount() const { return cached ? cached.indexCount : indices.size(); }
+  const FlowfieldLod* LodData() const { return cached ? cached.lods : lods.data(); }
+  size_t LodCount() const { return cached ? cached.lodCount : lods.size(); }
 };
 
 struct Mesh {
   GLuint vao = 0, vbo = 0, ebo = 0;
   size_t indexCount = 0;
   size_t vertexCount = 0;
+  GLenum indexType = GL_UNSIGNED_INT;
+
+  // Levels of detail of a flowfield mesh, empty to always draw all indices
+  std::vector<FlowfieldLod> lods;
+  glm::vec3 boundsCenter = {0.0f, 0.0f, 0.0f};
+  float boundsRadius = 0.0f;
+
+  // Vertex decoding of a flowfield mesh: position = aPos * posScale + posOffset, flow octahedral if octFlow
+  glm::vec3 posScale = {1.0f, 1.0f, 1.0f};
+  glm::vec3 posOffset = {0.0f, 0.0f, 0.0f};
+  bool octFlow = false;
+  size_t gpuBytes = 0; // vertex and index buffer size
+  FlowfieldDrawOrderStats drawOrder; // vertex cache efficiency of the full mesh, see MeshFlowfieldData
 
   Mesh() = default;
   ~Mesh() { Destroy(); }
   Mesh(Mesh&& other) noexcept;
   Mesh& operator=(Mesh&& other) noexcept;
 
-  void UploadIndexed(const void* vertexData, size_t vertexBytes, const unsigned int* indices, size_t indexCount);
+  void UploadIndexed(
+      const void* vertexData,
+      size_t vertexBytes,
+      const void* indices,
+      size_t indexCount,
+      GLenum indexType = GL_UNSIGNED_INT
+  );
   void UploadArrays(const void* vertexData, size_t vertexBytes, size_t vertexCount);
 
   void SetAttrib(GLuint location, GLint components, GLenum type, GLboolean normalized, GLsizei stride, size_t offset);
 
-  void Draw(int renderFlags = 0) const;
+  void Draw(int renderFlags = 0, int lod = 0) const;
   void Destroy();
 
   static Mesh CreateFullscreenQuad();
   static Mesh CreateTriangle();
 
+  // baker (optional) keeps the pipeline stages so later settings changes only redo the affected ones.
+  // compactFlowBits 16 or 8 also quantizes the mesh for upload, see flowfield_quantize.hpp, 0 keeps floats.
   static MeshFlowfieldData CreateFlowfieldDataFromOBJ(
-      int slot, const std::string& path, const FlowfieldSettings& settings
+      int slot,
+      const std::string& path,
+      const FlowfieldSettings& settings,
+      FlowfieldBaker* baker = nullptr,
+      int compactFlowBits = 0
   );
 
   void UploadFlowfieldMesh(const MeshFlowfieldData& data);
+
+  // Coarsest level of detail whose error stays within maxPixelError when one model unit at the nearest
+  // point of the bounds covers pixelsPerUnit pixels
+  int SelectLod(float pixelsPerUnit, float maxPixelError) const;
 };
 
 enum RenderFlag { DepthTest = 1 << 0, CullFace = 1 << 1 };
@@ -0,0 +1,36 @@
+#pragma once
+#include "flowfield/flowfield.hpp"
+
+#include <filesystem>
+#include <string>
+
+// Flow settings the app starts each bundled model with, picked by file name. Shared with noice-bake so
+// offline bakes land in the cache entries the app looks up. Other files get the settings for dropped files.
+inline FlowfieldSettings GetModelFlowfieldSettings(const std::string& objPath) {
+  struct Preset {
+    const char* fileName;
+    char axis;
+    float creaseThresholdAngle;
+  };
+  static const Preset presets[] = {
+      {"car.obj", 'A', 12},
+      {"interior.obj", 'A', 80},
+      {"dragon.obj", 'A', 15},
+      {"alien.obj", 'A', 45},
+      {"head.obj", 'A', 0},
+  };
+
+  FlowfieldSettings s;
+  s.axis = 'U';
+  s.creaseThresholdAngle = 0;
+  s.optimizeDrawOrder = true;
+
+  const std::string fileName = std::filesystem::path(objPath).filename().string();
+  for (const Preset& p : presets) {
+    if (fileName == p.fileName) {
+      s.axis = p.axis;
+      s.creaseThresholdAngle = p.creaseThresholdAngle;
+    }
+  }
+  return s;
+}
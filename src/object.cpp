@@ -1,13 +1,16 @@
 #include "object.hpp"
 
 #include "flowfield/flowfield.hpp"
+#include "flowfield/trace.hpp"
 #include "mesh.hpp"
+#include "model_presets.hpp"
 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <imgui.h>
 
+#include <algorithm>
 #include <thread>
 
 static std::string meshFilePaths[(size_t)ObjectMode::Model::Count] = {
@@ -58,6 +61,31 @@ void ObjectMode::UpdateImGui() {
   ImGui::DragFloat3("Rotation", (float*)&transforms[(int)objectSelect].rotation.x, 0.5f, 0, 0, "%.1f");
   ImGui::DragFloat("Scale", &transforms[(int)objectSelect].scale, 0.02f, 0, 0, "%.2f");
 
+  const Mesh& mesh = meshes[(int)objectSelect];
+  ImGui::SeparatorText("Level of Detail");
+  ImGui::DragFloat("Max Error Px", &lodPixelError, 0.05f, 0.0f, 16.0f, "%.2f", ImGuiSliderFlags_ClampOnInput);
+  if (!mesh.lods.empty()) {
+    const int lod = std::min(drawnLod, (int)mesh.lods.size() - 1);
+    ImGui::Text("LOD %d / %d (%u triangles)", lod, (int)mesh.lods.size() - 1, mesh.lods[lod].indexCount / 3);
+  }
+
+  ImGui::SeparatorText("Vertex Format");
+  static const char* formats[] = {"Float", "Compact 16-bit Flow", "Compact 8-bit Flow"};
+  int format = compactFlowBits == 16 ? 1 : compactFlowBits == 8 ? 2 : 0;
+  if (ImGui::Combo("Format", &format, formats, 3)) {
+    compactFlowBits = format == 1 ? 16 : format == 2 ? 8 : 0;
+    for (int type = 0; type < (int)Model::Count; type++) LoadMeshAsync((Model)type);
+  }
+  ImGui::Text("GPU %.1f KB (%s indices)", mesh.gpuBytes / 1024.0, mesh.indexType == GL_UNSIGNED_SHORT ? "16" : "32");
+  const FlowfieldDrawOrderStats& cache = mesh.drawOrder;
+  if (cache.before.acmr > 0.0f) {
+    const VertexCacheStats& a = cache.before;
+    const VertexCacheStats& b = cache.after;
+    ImGui::Text("ACMR %.2f > %.2f, ATVR %.2f > %.2f", a.acmr, b.acmr, a.atvr, b.atvr);
+  } else {
+    ImGui::Text("ACMR %.2f, ATVR %.2f", cache.after.acmr, cache.after.atvr);
+  }
+
   FlowfieldSettings& stored = flowSettings[(int)objectSelect];
   static FlowfieldSettings edit = stored;
   if (meshChanged) edit = stored;
@@ -70,8 +98,11 @@ void ObjectMode::UpdateImGui() {
   if (ImGui::RadioButton("Auto", edit.axis == 'A')) edit.axis = 'A';
 
   ImGui::DragFloat("Crease Deg", &edit.creaseThresholdAngle, 0.1f, 0.0f, 90.0f, "%.0f", ImGuiSliderFlags_ClampOnInput);
+  // Simplified levels picked by projected size, off by default as the chain costs a multiple of the bake
+  ImGui::DragInt("LODs", &edit.lodLevels, 0.05f, 0, 8, "%d", ImGuiSliderFlags_ClampOnInput);
 
-  bool differs = (edit.axis != stored.axis) || (edit.creaseThresholdAngle != stored.creaseThresholdAngle);
+  bool differs = (edit.axis != stored.axis) || (edit.creaseThresholdAngle != stored.creaseThresholdAngle)
+              || (edit.lodLevels != stored.lodLevels);
   ImGui::BeginDisabled(!differs);
   if (ImGui::Button("Reload Mesh")) {
     stored = edit;
@@ -83,6 +114,7 @@ void ObjectMode::UpdateImGui() {
 }
 
 void ObjectMode::Update(float dt) {
+  TRACE_ZONE("ObjectMode::Update");
   while (auto d = uploadQueue.TryPop()) meshes[d->slot].UploadFlowfieldMesh(*d);
 
   camera.Update(dt);
@@ -98,7 +130,19 @@ void ObjectMode::RenderObject() {
   objectShader.SetMat4("uViewproj", mvpState.currProj * mvpState.currView);
   objectShader.SetVec2("uViewportSize", {objectFB.tex.width, objectFB.tex.height});
 
-  meshes[(int)objectSelect].Draw(RenderFlag::DepthTest);
+  const Mesh& mesh = meshes[(int)objectSelect];
+  objectShader.SetVec3("uPosScale", mesh.posScale);
+  objectShader.SetVec3("uPosOffset", mesh.posOffset);
+  objectShader.SetInt("uOctFlow", mesh.octFlow);
+
+  // Pixels per model unit at the nearest point of the bounding sphere
+  const float scale = transforms[(int)objectSelect].scale;
+  const glm::vec4 viewCenter = mvpState.currView * mvpState.currModel * glm::vec4(mesh.boundsCenter, 1.0f);
+  const float depth = std::max(-viewCenter.z - mesh.boundsRadius * scale, 1e-3f);
+  const float pixelsPerUnit = scale * mvpState.currProj[1][1] * 0.5f * (float)objectFB.tex.height / depth;
+
+  drawnLod = mesh.SelectLod(pixelsPerUnit, lodPixelError);
+  mesh.Draw(RenderFlag::DepthTest, drawnLod);
 }
 
 void ObjectMode::UpdateTransformMatrices(float dt) {
@@ -177,24 +221,29 @@ void ObjectMode::SetInitialObjectTransforms() {
 }
 
 void ObjectMode::SetInitialFlowfieldSettings() {
-  flowSettings[(int)Model::Custom] = {'U', 0};
-  flowSettings[(int)Model::Car] = {'A', 12};
-  flowSettings[(int)Model::Interior] = {'A', 80};
-  flowSettings[(int)Model::Dragon] = {'A', 15};
-  flowSettings[(int)Model::Alien] = {'A', 45};
-  flowSettings[(int)Model::Head] = {'A', 0};
+  for (int type = 0; type < (int)Model::Count; type++) {
+    flowSettings[type] = GetModelFlowfieldSettings(meshFilePaths[type]);
+  }
 }
 
 void ObjectMode::LoadMeshAsync(Model type) {
   std::string& path = meshFilePaths[(int)type];
   FlowfieldSettings& settings = flowSettings[(int)type];
-  meshJobQueue.Push(ModelLoadJob{type, path, settings});
+  meshJobQueue.Push(ModelLoadJob{type, path, settings, compactFlowBits});
 }
 
 void ObjectMode::MeshLoaderThreadFunc(Queue<ModelLoadJob>& meshJobQueue, Queue<MeshFlowfieldData>& uploadQueue) {
+  // Pipeline stages per model, so "Reload Mesh" after a settings tweak only redoes the affected stages
+  FlowfieldBaker bakers[(size_t)Model::Count];
+  trace::SetThreadName("mesh loader");
+
   while (meshJobQueue) {
     if (auto job = meshJobQueue.TryPop()) {
-      uploadQueue.Push(Mesh::CreateFlowfieldDataFromOBJ((int)job->type, job->path, job->settings));
+      TRACE_ZONE("ObjectMode::LoadMesh");
+      FlowfieldBaker* baker = &bakers[(int)job->type];
+      uploadQueue.Push(
+          Mesh::CreateFlowfieldDataFromOBJ((int)job->type, job->path, job->settings, baker, job->compactFlowBits)
+      );
     } else {
       std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
@@ -24,6 +24,7 @@ public:
     Model type;
     std::string path;
     FlowfieldSettings settings;
+    int compactFlowBits;
   };
 
 public:
@@ -64,6 +65,11 @@ private:
   MvpState mvpState;
   bool hasValidPrevMvp = false;
 
+  float lodPixelError = 1.0f; // largest screen-space error of the drawn level of detail
+  int drawnLod = 0;
+
+  int compactFlowBits = 0; // flow precision of compact vertices, 0 uploads floats, the Vertex Format combo opts in
+
 private:
   std::thread meshLoaderThread;
 
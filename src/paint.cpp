@@ -1,5 +1,6 @@
 #include "paint.hpp"
 
+#include "flowfield/trace.hpp"
 #include "util.hpp"
 
 #include <GLFW/glfw3.h>
@@ -34,6 +35,7 @@ void PaintMode::UpdateImGui() {
 }
 
 void PaintMode::Update(float dt) {
+  TRACE_ZONE("PaintMode::Update");
   if (leftDown) {
     if (!havePrev) {
       prevPos = mousePos;
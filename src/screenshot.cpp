@@ -1,5 +1,6 @@
 #include "screenshot.hpp"
 
+#include "flowfield/trace.hpp"
 #include "util.hpp"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -67,6 +68,7 @@ void Screenshot::UpdateImGui() {
 }
 
 void Screenshot::Update(const Texture& source) {
+  TRACE_ZONE("Screenshot::Update");
   if (source.width != width || source.height != height) ResizeBuffers(source.width, source.height);
   if (!capturing) return;
 
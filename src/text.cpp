@@ -1,5 +1,6 @@
 #include "text.hpp"
 
+#include "flowfield/trace.hpp"
 #include "util.hpp"
 
 #define STB_TRUETYPE_IMPLEMENTATION
@@ -43,6 +44,7 @@ void TextMode::UpdateImGui() {
 }
 
 void TextMode::Update(float dt) {
+  TRACE_ZONE("TextMode::Update");
   if (!ImGui::GetIO().WantCaptureKeyboard) {
     auto win = glfwGetCurrentContext();
     if (glfwGetKey(win, GLFW_KEY_W) == GLFW_PRESS) {
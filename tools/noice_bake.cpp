@@ -0,0 +1,330 @@
+#include "flowfield/flowfield.hpp"
+#include "flowfield/flowfield_cache.hpp"
+#include "flowfield/flowfield_optimize.hpp"
+#include "flowfield/flowfield_stream.hpp"
+#include "model_presets.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Bakes OBJ files into the flowfield cache without a window or OpenGL context, so the app only maps the results.
+// By default every file gets the axis and crease angle the app starts it with (model_presets.hpp), so baking
+// assets/models fills the entries the app looks up. Settings changed in the app need the same flags here.
+
+struct BakeOptions {
+  FlowfieldSettings settings;
+  bool appPresets = true;      // axis and crease angle per file from GetModelFlowfieldSettings
+  std::optional<char> axis;    // --axis, overrides the preset
+  std::optional<float> crease; // --crease, overrides the preset
+  std::string cacheDir = defaultFlowfieldCacheDir;
+  uintmax_t streamAbove = (uintmax_t)1 << 30; // files from this size bake out of core, as in the app
+  int jobs = 0;                               // files baked at once, 0 picks from the hardware threads
+  bool force = false;
+};
+
+enum class BakeStatus { Baked, Streamed, Cached, Failed };
+
+struct BakeResult {
+  BakeStatus status = BakeStatus::Failed;
+  double ms = 0.0;
+  size_t vertices = 0;
+  size_t triangles = 0;
+  size_t lods = 0;
+  FlowfieldDrawOrderStats drawOrder; // before only for in-memory bakes that optimized the draw order, 0 otherwise
+};
+
+static void printUsage() {
+  std::printf(
+      "usage: noice-bake [options] <dir or .obj>...\n"
+      "directories are searched recursively for .obj files\n"
+      "options:\n"
+      "  --preset app|none  app: axis and crease angle the app uses for each bundled model, U and 0 for other\n"
+      "                     files (default); none: U and 0 for every file\n"
+      "  --axis U|V|A       flow axis of every file, overrides the preset\n"
+      "  --crease DEG       crease threshold angle of every file, 0 disables crease splitting, overrides the preset\n"
+      "  --lods N           simplified levels of detail (default 0)\n"
+      "  --no-optimize      keep the bake's draw order\n"
+      "  --reorder          renumber the input along a Morton curve first, for scans in shuffled order\n"
+      "  --float            accumulate normals and tangents in float\n"
+      "  --jobs N           files baked at once (default: a quarter of the hardware threads)\n"
+      "  --threads N        worker threads per bake (default: hardware threads / jobs)\n"
+      "  --cache DIR        cache directory (default %s)\n"
+      "  --stream-above MB  bake files from this size out of core (default 1024)\n"
+      "  --force            rebake entries that are up to date\n"
+      "  --help             print this and exit\n",
+      defaultFlowfieldCacheDir
+  );
+}
+
+// Files named more than once, directly or through overlapping directories, are baked once
+static std::vector<std::string> collectObjFiles(const std::vector<std::string>& inputs) {
+  std::vector<std::string> files;
+  std::unordered_set<std::string> seen;
+  auto add = [&](const std::filesystem::path& path) {
+    std::error_code ec;
+    std::filesystem::path key = std::filesystem::weakly_canonical(path, ec);
+    if (ec) key = std::filesystem::absolute(path, ec).lexically_normal();
+    if (seen.insert(key.generic_string()).second) files.push_back(path.generic_string());
+  };
+
+  for (const std::string& input : inputs) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(input, ec)) {
+      add(input);
+      continue;
+    }
+
+    std::vector<std::filesystem::path> found;
+    for (const auto& e : std::filesystem::recursive_directory_iterator(input, ec)) {
+      if (e.is_regular_file(ec) && e.path().extension() == ".obj") found.push_back(e.path());
+    }
+    std::sort(found.begin(), found.end());
+    for (const auto& path : found) add(path);
+  }
+  return files;
+}
+
+// Size in MB as a positive whole number that fits in bytes, false otherwise
+static bool parseMegabytes(const char* s, uintmax_t& bytes) {
+  char* end = nullptr;
+  errno = 0;
+  const long long mb = std::strtoll(s, &end, 10);
+  if (errno || end == s || *end != '\0' || mb <= 0 || (uintmax_t)mb > (UINTMAX_MAX >> 20)) return false;
+  bytes = (uintmax_t)mb << 20;
+  return true;
+}
+
+static FlowfieldSettings settingsFor(const std::string& path, const BakeOptions& options) {
+  FlowfieldSettings s = options.settings;
+  if (options.appPresets) {
+    const FlowfieldSettings preset = GetModelFlowfieldSettings(path);
+    s.axis = preset.axis;
+    s.creaseThresholdAngle = preset.creaseThresholdAngle;
+  }
+  if (options.axis) s.axis = *options.axis;
+  if (options.crease) s.creaseThresholdAngle = *options.crease;
+  return s;
+}
+
+static BakeResult bakeFile(const std::string& path, const BakeOptions& options) {
+  BakeResult r;
+  const FlowfieldSettings settings = settingsFor(path, options);
+  auto t0 = std::chrono::steady_clock::now();
+  auto finish = [&](BakeStatus status) {
+    r.status = status;
+    r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return r;
+  };
+
+  std::error_code ec;
+  const uintmax_t fileSize = std::filesystem::file_size(path, ec);
+  const bool streamed = !ec && fileSize >= options.streamAbove;
+  const FlowfieldCacheLayout layout = streamed ? FlowfieldCacheLayout::Streamed : FlowfieldCacheLayout::InMemory;
+
+  bool objOk = false;
+  const uint64_t objHash = HashFileContents(path, &objOk);
+  if (!objOk) return finish(BakeStatus::Failed);
+
+  if (!options.force) {
+    FlowfieldCacheEntry entry;
+    if (LoadFlowfieldCache(objHash, settings, layout, entry, options.cacheDir)) {
+      r.vertices = entry.vertFloatCount / 6;
+      r.triangles = (entry.lodCount ? entry.lods[0].indexCount : entry.indexCount) / 3;
+      r.lods = entry.lodCount;
+      r.drawOrder.after =
+          AnalyzeFlowfieldMesh(entry.indices, entry.indexCount, r.vertices, entry.lods, entry.lodCount);
+      return finish(BakeStatus::Cached);
+    }
+  }
+
+  if (streamed) {
+    FlowfieldCacheEntry entry;
+    if (!BakeFlowfieldStreaming(path, objHash, settings, {}, nullptr, options.cacheDir)) {
+      return finish(BakeStatus::Failed);
+    }
+    if (!LoadFlowfieldCache(objHash, settings, layout, entry, options.cacheDir)) {
+      return finish(BakeStatus::Failed);
+    }
+    r.vertices = entry.vertFloatCount / 6;
+    r.triangles = entry.indexCount / 3;
+    r.drawOrder.after = AnalyzeFlowfieldMesh(entry.indices, entry.indexCount, r.vertices);
+    return finish(BakeStatus::Streamed);
+  }
+
+  std::vector<float> verts;
+  std::vector<unsigned int> indices;
+  std::vector<FlowfieldLod> lods;
+  if (!ComputeUvFlowfieldFromOBJ(path, verts, indices, settings, &lods, nullptr, &r.drawOrder)) {
+    return finish(BakeStatus::Failed);
+  }
+  if (!settings.optimizeDrawOrder) r.drawOrder.before = VertexCacheStats();
+  if (!StoreFlowfieldCache(objHash, settings, layout, verts, indices, lods, options.cacheDir)) {
+    return finish(BakeStatus::Failed);
+  }
+
+  r.vertices = verts.size() / 6;
+  r.triangles = (lods.empty() ? indices.size() : lods[0].indexCount) / 3;
+  r.lods = lods.size();
+  return finish(BakeStatus::Baked);
+}
+
+// "before > after", or only the final value when the bake's order is unknown
+static std::string formatCacheStat(float before, float after) {
+  char buf[32];
+  if (before > 0.0f) std::snprintf(buf, sizeof(buf), "%.2f > %.2f", before, after);
+  else std::snprintf(buf, sizeof(buf), "%.2f", after);
+  return buf;
+}
+
+static const char* statusName(BakeStatus status) {
+  switch (status) {
+  case BakeStatus::Baked: return "baked";
+  case BakeStatus::Streamed: return "streamed";
+  case BakeStatus::Cached: return "cached";
+  case BakeStatus::Failed: return "FAILED";
+  }
+  return "";
+}
+
+int main(int argc, char** argv) {
+  BakeOptions options;
+  FlowfieldSettings& settings = options.settings;
+  settings.axis = 'U';
+  settings.optimizeDrawOrder = true;
+
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; ++i) {
+    const bool hasValue = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--help") || !std::strcmp(argv[i], "-h")) {
+      printUsage();
+      return 0;
+    }
+    else if (!std::strcmp(argv[i], "--preset") && hasValue) {
+      const char* preset = argv[++i];
+      if (std::strcmp(preset, "app") && std::strcmp(preset, "none")) {
+        std::fprintf(stderr, "--preset needs app or none, got %s\n", preset);
+        return 1;
+      }
+      options.appPresets = !std::strcmp(preset, "app");
+    }
+    else if (!std::strcmp(argv[i], "--axis") && hasValue) options.axis = argv[++i][0];
+    else if (!std::strcmp(argv[i], "--crease") && hasValue) options.crease = (float)std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--lods") && hasValue) settings.lodLevels = std::max(0, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--no-optimize")) settings.optimizeDrawOrder = false;
+    else if (!std::strcmp(argv[i], "--reorder")) settings.spatialReorder = true;
+    else if (!std::strcmp(argv[i], "--float")) settings.singlePrecision = true;
+    else if (!std::strcmp(argv[i], "--jobs") && hasValue) options.jobs = std::max(0, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--threads") && hasValue) settings.threads = std::max(0, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--cache") && hasValue) options.cacheDir = argv[++i];
+    else if (!std::strcmp(argv[i], "--stream-above") && hasValue) {
+      if (!parseMegabytes(argv[++i], options.streamAbove)) {
+        std::fprintf(stderr, "--stream-above needs a positive size in MB, got %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (!std::strcmp(argv[i], "--force")) options.force = true;
+    else if (argv[i][0] == '-') {
+      printUsage();
+      return 1;
+    } else inputs.push_back(argv[i]);
+  }
+
+  const bool badAxis = options.axis && *options.axis != 'U' && *options.axis != 'V' && *options.axis != 'A';
+  if (inputs.empty() || badAxis) {
+    printUsage();
+    return 1;
+  }
+
+  const std::vector<std::string> files = collectObjFiles(inputs);
+  if (files.empty()) {
+    std::fprintf(stderr, "No OBJ files found\n");
+    return 1;
+  }
+
+  // A few bakes at once, each with a share of the hardware threads: the stages do not scale perfectly with the
+  // thread count, and bounding the jobs bounds the memory of the bakes in flight
+  const int hardwareThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+  const int jobs = std::min((int)files.size(), options.jobs > 0 ? options.jobs : std::max(1, hardwareThreads / 4));
+  if (settings.threads == 0) settings.threads = std::max(1, hardwareThreads / jobs);
+
+  std::error_code ec;
+  std::filesystem::create_directories(options.cacheDir, ec);
+  std::printf(
+      "%zu files, %d jobs, %d threads per bake, cache %s\n\n",
+      files.size(),
+      jobs,
+      settings.threads,
+      options.cacheDir.c_str()
+  );
+  std::printf(
+      "%-9s %10s %10s %10s %5s %12s %12s  %s\n",
+      "status",
+      "ms",
+      "vertices",
+      "triangles",
+      "lods",
+      "acmr",
+      "atvr",
+      "file"
+  );
+
+  std::vector<BakeResult> results(files.size());
+  std::atomic<size_t> next{0};
+  std::mutex printMutex;
+  auto worker = [&] {
+    for (size_t f = next++; f < files.size(); f = next++) {
+      results[f] = bakeFile(files[f], options);
+      const BakeResult& r = results[f];
+
+      std::lock_guard<std::mutex> lock(printMutex);
+      std::printf(
+          "%-9s %10.1f %10zu %10zu %5zu %12s %12s  %s\n",
+          statusName(r.status),
+          r.ms,
+          r.vertices,
+          r.triangles,
+          r.lods,
+          formatCacheStat(r.drawOrder.before.acmr, r.drawOrder.after.acmr).c_str(),
+          formatCacheStat(r.drawOrder.before.atvr, r.drawOrder.after.atvr).c_str(),
+          files[f].c_str()
+      );
+      std::fflush(stdout);
+    }
+  };
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (int j = 0; j < jobs; ++j) pool.emplace_back(worker);
+  for (std::thread& t : pool) t.join();
+  const double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+  int counts[4] = {};
+  double bakeMs = 0.0;
+  for (const BakeResult& r : results) {
+    counts[(int)r.status]++;
+    bakeMs += r.ms;
+  }
+  std::printf(
+      "\n%d baked, %d streamed, %d cached, %d failed in %.1f ms (%.1f ms of bakes)\n",
+      counts[(int)BakeStatus::Baked],
+      counts[(int)BakeStatus::Streamed],
+      counts[(int)BakeStatus::Cached],
+      counts[(int)BakeStatus::Failed],
+      wallMs,
+      bakeMs
+  );
+  return counts[(int)BakeStatus::Failed] ? 1 : 0;
+}